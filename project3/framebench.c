@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define VALID 1
+#define DIRTY 2
+#define REFERENCED 4
+
+#define WORK (1 << 26)
+#define TAU 1000
+
+// Compares the old array-of-structs frame table with the parallel arrays
+// vmsim uses now, on the scans the simulator still does over every frame.
+// Both layouts start from the same state and apply the same predicates in
+// the same order.
+
+struct frameStruct {
+    unsigned int index;
+    unsigned int valid;
+    unsigned int dirty;
+    unsigned int referenced;
+    unsigned int tim;
+};
+
+double now();
+void bench(int numframes);
+
+volatile unsigned int sink;
+
+int main(int argc, char *argv[]) {
+    int n;
+    printf("frames\tscan\t\tAoS ns/frame\tSoA ns/frame\n");
+    for (n = 1024; n <= 65536; n *= 4) {
+        bench(n);
+    }
+    return 0;
+}
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+void bench(int numframes) {
+    struct frameStruct *frameArray = (struct frameStruct*)malloc(numframes*sizeof(struct frameStruct));
+    unsigned int *framePage = (unsigned int*)malloc(numframes*sizeof(unsigned int));
+    unsigned char *frameFlags = (unsigned char*)malloc(numframes*sizeof(unsigned char));
+    unsigned int *frameTime = (unsigned int*)malloc(numframes*sizeof(unsigned int));
+    if (!frameArray || !framePage || !frameFlags || !frameTime) {
+        exit(1);
+    }
+
+    int i, r;
+    int reps = WORK/numframes;
+    unsigned int min, count;
+    double t, aos, soa;
+    srand(numframes);
+    for (i = 0; i < numframes; i++) {
+        frameArray[i].index = rand();
+        frameArray[i].valid = 1;
+        frameArray[i].dirty = rand()%2;
+        frameArray[i].referenced = rand()%2;
+        frameArray[i].tim = rand();
+        framePage[i] = frameArray[i].index;
+        frameFlags[i] = VALID | (frameArray[i].dirty ? DIRTY : 0) | (frameArray[i].referenced ? REFERENCED : 0);
+        frameTime[i] = frameArray[i].tim;
+    }
+
+    // Victim scan: the oldest timestamp, as in WSClock's fallback when a
+    // whole turn finds nothing to evict.
+    t = now();
+    for (r = 0; r < reps; r++) {
+        min = ~0U;
+        for (i = 0; i < numframes; i++) {
+            if (frameArray[i].tim < min) {
+                min = frameArray[i].tim;
+            }
+        }
+        sink = min;
+    }
+    aos = now()-t;
+    t = now();
+    for (r = 0; r < reps; r++) {
+        min = ~0U;
+        for (i = 0; i < numframes; i++) {
+            if (frameTime[i] < min) {
+                min = frameTime[i];
+            }
+        }
+        sink = min;
+    }
+    soa = now()-t;
+    printf("%d\toldest scan\t%.3f\t\t%.3f\n", numframes, aos*1e9/WORK, soa*1e9/WORK);
+
+    // Flag scan: count clean unreferenced frames, as a clock hand sees them.
+    t = now();
+    for (r = 0; r < reps; r++) {
+        count = 0;
+        for (i = 0; i < numframes; i++) {
+            count += !frameArray[i].referenced && !frameArray[i].dirty;
+        }
+        sink = count;
+    }
+    aos = now()-t;
+    t = now();
+    for (r = 0; r < reps; r++) {
+        count = 0;
+        for (i = 0; i < numframes; i++) {
+            count += !(frameFlags[i] & (REFERENCED | DIRTY));
+        }
+        sink = count;
+    }
+    soa = now()-t;
+    printf("%d\tflag scan\t%.3f\t\t%.3f\n", numframes, aos*1e9/WORK, soa*1e9/WORK);
+
+    // WSClock sweep: a full turn of the hand without evicting, clearing R
+    // bits and cleaning old dirty pages as my_wsclock does. Every fourth R
+    // bit is set again before each turn, as hits would.
+    t = now();
+    for (r = 0; r < reps; r++) {
+        for (i = r%4; i < numframes; i += 4) {
+            frameArray[i].referenced = 1;
+        }
+        for (i = 0; i < numframes; i++) {
+            if (!frameArray[i].referenced) {
+                if (r-frameArray[i].tim > TAU && frameArray[i].dirty) {
+                    frameArray[i].dirty = 0;
+                }
+            }
+            else {
+                frameArray[i].tim = r;
+                frameArray[i].referenced = 0;
+            }
+        }
+    }
+    aos = now()-t;
+    t = now();
+    for (r = 0; r < reps; r++) {
+        for (i = r%4; i < numframes; i += 4) {
+            frameFlags[i] |= REFERENCED;
+        }
+        for (i = 0; i < numframes; i++) {
+            if (!(frameFlags[i] & REFERENCED)) {
+                if (r-frameTime[i] > TAU && (frameFlags[i] & DIRTY)) {
+                    frameFlags[i] &= ~DIRTY;
+                }
+            }
+            else {
+                frameTime[i] = r;
+                frameFlags[i] &= ~REFERENCED;
+            }
+        }
+    }
+    soa = now()-t;
+    printf("%d\twsclock sweep\t%.3f\t\t%.3f\n", numframes, aos*1e9/WORK, soa*1e9/WORK);
+
+    free(frameArray);
+    free(framePage);
+    free(frameFlags);
+    free(frameTime);
+}
@@ -2,57 +2,526 @@
 #include <stdio.h>
 #include <getopt.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <zlib.h>
 
-#define OPT 1
-#define CLOCK 2
-#define AGING 3
-#define WSCLOCK 4
+#define CHUNK 4096
+#define READBUF (1 << 20)
+#define MAXLINE 64
+#define BINMAGIC 0x52544d56
+#define BINMAGIC64 0x38544d56
+#define GZMAGIC 0x8b1f
+#define GZBUFS 4
 
-void read_access(int i, unsigned int addr, unsigned char mode);
+#define PAGEBITS 12
+#define HUGEBITS 21
+#define PROCSHIFT (64-PAGEBITS)
+#define REGIONSHIFT (HUGEBITS-pageBits)
+#define MAXPROCS 1024
+
+#define VALID 1
+#define DIRTY 2
+#define REFERENCED 4
+#define HOT 8
+#define TEST 16
+#define STACKED 32
+#define PREFETCHED 64
+
+#define LISTS 4
+#define T1 0
+#define T2 1
+#define B1 2
+#define B2 3
+#define A1IN 0
+#define A1OUT 1
+#define AM 2
+#define HIRS 0
+#define GHOSTS 1
+
+#define LEAFBITS 10
+#define NODEBITS 13
+
+#define WALKCYCLES 30
+#define HUGEKEY (1ULL << 63)
+#define CACHELEVELS 3
+#define LINEBITS 6
+#define HITNS 100
+#define CLEANNS 100000
+#define DIRTYNS 200000
+#define WINDOW 10000
+#define PREFETCHMAX 16
+#define MARKOVBITS 16
+#define FLUSHBATCH 32
+#define DISKLATENCY 100
+
+#define TUNESTEPS 16
+#define AGEVEC 32
+
+struct traceStruct;
+struct radixStruct;
+struct cacheStruct;
+struct windowStruct;
+struct prefetchStruct;
+struct simStruct;
+struct policyStruct;
+
+void read_access(int i, int proc, unsigned long long addr, unsigned char mode);
+int proc_slot(unsigned int pid);
+void open_trace(struct traceStruct *trace, char *tracefile);
+void close_trace(struct traceStruct *trace);
+void fill_trace(struct traceStruct *trace);
+int read_bytes(struct traceStruct *trace, unsigned char *dst, int want);
+void *inflate_trace(void *arg);
+void convert_tracefile(char *tracefile, char *binfile);
+int refill_line(struct traceStruct *trace, unsigned char *line, unsigned char *p);
+int read_chunk(struct traceStruct *trace, int start, int max);
+double now();
 void read_tracefile(char *tracefile);
-void init_frame();
-void access_frame();
-void my_opt(int cur, unsigned int index, unsigned char mode);
-int find_next(int cur, unsigned int index);
-void my_clock(unsigned int index, unsigned char mode);
-void my_aging(unsigned int index, unsigned char mode);
-void my_wsclock(int cur, unsigned int index, unsigned char mode);
+void stream_tracefile(struct simStruct *list, int n, char *tracefile);
+int parse_size(char *arg);
+void init_frame(struct simStruct *sim);
+void huge_add(struct simStruct *sim, unsigned long long index);
+void huge_remove(struct simStruct *sim, unsigned long long index);
+void huge_collapse(struct simStruct *sim, int cur, unsigned long long index);
+double huge_reach(struct simStruct *sim);
+void parse_tlb(char *arg, int *entries, int *ways, int *random, int *walk);
+unsigned long long tlb_key(struct simStruct *sim, unsigned long long index);
+void tlb_access(struct simStruct *sim, unsigned long long index);
+void tlb_flush(struct simStruct *sim, unsigned long long key);
+void parse_cache(char *arg, struct cacheStruct *cache, int *levels);
+void cache_access(struct simStruct *sim, int j, unsigned int offset, unsigned char mode);
+void cache_ref(struct simStruct *sim, int k, unsigned long long line, int write, int demand);
+void cache_flush(struct simStruct *sim, int j);
+void parse_flush(char *arg, int *interval, int *batch, int *latency);
+void flush_tick(struct simStruct *sim, int cur);
+void disk_io(struct simStruct *sim, int wait);
+void disk_idle(struct simStruct *sim);
+void parse_cost(char *arg, int *hit, int *clean, int *dirty);
+char *parse_timeline(char *arg, int *window);
+long long sim_time(struct simStruct *sim, int refs);
+void timeline_add(struct simStruct *sim, int end);
+void write_timeline(char *file, struct simStruct *list, int n);
+struct prefetchStruct *parse_prefetch(char *arg, int *degree);
+void prefetch_run(struct simStruct *sim, int cur, unsigned long long index);
+void prefetch_page(struct simStruct *sim, int cur, unsigned long long index, unsigned long long page);
+int load_page(struct simStruct *sim, int cur, unsigned long long page);
+void seq_predict(struct simStruct *sim, int cur, unsigned long long index);
+void stride_predict(struct simStruct *sim, int cur, unsigned long long index);
+void init_markov(struct simStruct *sim);
+void markov_predict(struct simStruct *sim, int cur, unsigned long long index);
+void free_frame(struct simStruct *sim);
+void *run_sweep(void *arg);
+void run_sims(struct simStruct *list, int n);
+void tune_policy(struct simStruct *base, int n);
+void set_param(struct simStruct *sim, int value);
+void print_summary(struct simStruct *sim);
+void set_frame(struct simStruct *sim, int j, unsigned long long index);
+void evict_frame(struct simStruct *sim, int j, unsigned long long index, unsigned char mode);
+void access_frame(struct simStruct *sim);
+void access_page(struct simStruct *sim, int cur, unsigned long long index, unsigned int offset, unsigned char mode);
+int lookup_page(struct simStruct *sim, unsigned long long index);
+void radix_init(struct radixStruct *tree, int empty);
+int *radix_leaf(struct radixStruct *tree, unsigned long long key, int create);
+int radix_get(struct radixStruct *tree, unsigned long long key);
+int *radix_slot(struct radixStruct *tree, unsigned long long key);
+void radix_set(struct radixStruct *tree, unsigned long long key, int value);
+void radix_free_node(void *node, int height);
+void radix_free(struct radixStruct *tree);
+void heap_swap(struct simStruct *sim, int a, int b);
+void heap_up(struct simStruct *sim, int i);
+void heap_down(struct simStruct *sim, int i);
+void heap_push(struct simStruct *sim, int j);
+void heap_update(struct simStruct *sim, int j);
+void init_next();
+void stack_distance(int maxframes);
+int fenwick_sum(int *tree, int pos);
+void fenwick_add(int *tree, int pos, int val);
+void init_heap(struct simStruct *sim);
+int opt_before(struct simStruct *sim, int a, int b);
+void opt_hit(struct simStruct *sim, int cur, int j);
+void opt_fill(struct simStruct *sim, int cur, int j);
+void my_opt(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void clock_hit(struct simStruct *sim, int cur, int j);
+void my_clock(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void init_aging(struct simStruct *sim);
+unsigned long long age_get(struct simStruct *sim, int j);
+void age_set(struct simStruct *sim, int j, unsigned long long value);
+void age_shift(struct simStruct *sim);
+int age_min(struct simStruct *sim);
+void aging_tick(struct simStruct *sim, int cur);
+void aging_hit(struct simStruct *sim, int cur, int j);
+void aging_fill(struct simStruct *sim, int cur, int j);
+void my_aging(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void my_wsclock(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+int local_under(struct simStruct *sim, int p);
+int local_victim(struct simStruct *sim, int j, int p, int under);
+void init_lists(struct simStruct *sim, int heads, int ghosts);
+void init_list(struct simStruct *sim);
+int list_first(struct simStruct *sim, int h);
+void list_remove(struct simStruct *sim, int j);
+void list_insert(struct simStruct *sim, int at, int j);
+void list_append(struct simStruct *sim, int h, int j);
+void list_fill(struct simStruct *sim, int cur, int j);
+void lru_hit(struct simStruct *sim, int cur, int j);
+void my_lru(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void fifo_hit(struct simStruct *sim, int cur, int j);
+void my_fifo(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void my_random(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void nru_tick(struct simStruct *sim, int cur);
+void my_nru(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void second_fill(struct simStruct *sim, int cur, int j);
+void my_second(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+int ghost_lookup(struct simStruct *sim, unsigned long long index);
+int ghost_find(struct simStruct *sim, unsigned long long index);
+int ghost_new(struct simStruct *sim, int j);
+void ghost_drop(struct simStruct *sim, int g);
+void init_arc(struct simStruct *sim);
+void arc_hit(struct simStruct *sim, int cur, int j);
+void arc_fill(struct simStruct *sim, int cur, int j);
+int arc_replace(struct simStruct *sim, int inB2);
+void my_arc(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void car_fill(struct simStruct *sim, int cur, int j);
+int car_replace(struct simStruct *sim);
+void my_car(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void init_clockpro(struct simStruct *sim);
+void clockpro_unlink(struct simStruct *sim, int n);
+void clockpro_head(struct simStruct *sim, int n);
+void clockpro_fill(struct simStruct *sim, int cur, int j);
+int clockpro_cold(struct simStruct *sim);
+void clockpro_hot(struct simStruct *sim);
+void clockpro_test(struct simStruct *sim);
+void my_clockpro(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void init_2q(struct simStruct *sim);
+void twoq_hit(struct simStruct *sim, int cur, int j);
+void twoq_fill(struct simStruct *sim, int cur, int j);
+void my_2q(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+void init_lirs(struct simStruct *sim);
+void stack_remove(struct simStruct *sim, int n);
+void stack_insert(struct simStruct *sim, int at, int n);
+void lirs_prune(struct simStruct *sim);
+void lirs_promote(struct simStruct *sim, int j);
+void lirs_hit(struct simStruct *sim, int cur, int j);
+void lirs_fill(struct simStruct *sim, int cur, int j);
+void my_lirs(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+
+// Aging counters are scanned AGEVEC bytes at a time with GCC vector
+// extensions, which become SSE2 or AVX2 code depending on -m flags.
+typedef unsigned char ageVec8 __attribute__((vector_size(AGEVEC)));
+typedef unsigned short ageVec16 __attribute__((vector_size(AGEVEC)));
+typedef unsigned int ageVec32 __attribute__((vector_size(AGEVEC)));
+typedef unsigned long long ageVec64 __attribute__((vector_size(AGEVEC)));
 
+// index holds the page number, with the process number above PROCSHIFT
+// so that each process has its own slice of the page table.
 struct accessStruct {
-    unsigned int index;
+    unsigned long long index;
     unsigned int offset;
     unsigned char mode;
 };
 
-struct frameStruct {
-    unsigned int index;
-    unsigned int valid;
-    unsigned int dirty;
-    unsigned int referenced;
-    unsigned int tim;
+// Binary traces are this header followed by one word per reference holding
+// the page number shifted left by one, with bit 0 set for writes. Words are
+// 64 bits under BINMAGIC64 and 32 bits in older BINMAGIC files.
+struct binHeader {
+    unsigned int magic;
+    unsigned int pageSize;
+    unsigned long long count;
+};
+
+struct traceStruct {
+    int fd;
+    unsigned char *buf;
+    int pos;
+    int len;
+    int eof;
+    long long bytes;
+    struct binHeader *map;
+    size_t mapSize;
+    void *records;
+    int wide;
+    unsigned long long next;
+    int shift;
+    gzFile gz;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned char *gzBuf[GZBUFS];
+    int gzLen[GZBUFS];
+    int gzHead;
+    int gzTail;
+    int gzCount;
+    int gzOff;
+    int gzStop;
+};
+
+// A sparse radix tree from page numbers to ints, for page tables and other
+// per-page state. Leaves hold 1 << LEAFBITS entries and inner nodes
+// 1 << NODEBITS children; the tree only grows as tall as the largest key
+// needs, so 32-bit traces pay for a single inner level. Untouched ranges
+// read as empty and take no memory. The last leaf found is cached, as
+// most references land near the one before.
+struct radixStruct {
+    void *root;
+    int height;
+    int empty;
+    unsigned long long lastKey;
+    int *lastLeaf;
+};
+
+// One level of the cache hierarchy: sets of ways lines each, size bytes in
+// all, with a tag, LRU stamp and dirty bit per line.
+struct cacheStruct {
+    int size;
+    int ways;
+    int sets;
+    unsigned long long *tag;
+    unsigned int *stamp;
+    unsigned char *dirty;
+    unsigned int clock;
+    int accesses;
+    int misses;
+};
+
+// One window of the --timeline output: the references up to end, the
+// faults since the window before, and the dirty pages resident and
+// simulated time at its close.
+struct windowStruct {
+    int end;
+    int faults;
+    int dirty;
+    long long time;
+};
+
+// A replacement policy. access_page() calls tick before every reference,
+// lookup to find the page, then hit on a hit, fill after loading into a
+// free frame, or fault to pick a victim when memory is full. init, tick
+// and before may be NULL; before orders frames for the victim heap. param
+// names the option (-r or -t) that --tune searches, if any.
+struct policyStruct {
+    char *name;
+    int future;
+    char param;
+    void (*init)(struct simStruct *sim);
+    void (*tick)(struct simStruct *sim, int cur);
+    int (*lookup)(struct simStruct *sim, unsigned long long index);
+    void (*hit)(struct simStruct *sim, int cur, int j);
+    void (*fill)(struct simStruct *sim, int cur, int j);
+    void (*fault)(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode);
+    int (*before)(struct simStruct *sim, int a, int b);
+};
+
+// A prefetcher. predict is called with the page of every demand fault and
+// of every hit on a prefetched page, as the miss that prefetch saved, and
+// loads what it expects next with prefetch_page(). init may be NULL.
+struct prefetchStruct {
+    char *name;
+    void (*init)(struct simStruct *sim);
+    void (*predict)(struct simStruct *sim, int cur, unsigned long long index);
+};
+
+// Everything one simulation owns, so several can run over the same
+// accessArray at once on different threads.
+struct simStruct {
+    struct policyStruct *policy;
+    int numframes;
+    int refresh;
+    int tau;
+    int ageWidth;
+    int ageVecs;
+    void *age;
+    unsigned long long *framePage;
+    unsigned char *frameFlags;
+    unsigned int *frameTime;
+    int *listPrev;
+    int *listNext;
+    unsigned char *listId;
+    int listLen[LISTS];
+    int listBase;
+    unsigned long long *ghostPage;
+    int *ghostFree;
+    int numGhostFree;
+    int target;
+    int hotPages;
+    int handHot;
+    int handCold;
+    int handTest;
+    int *stackPrev;
+    int *stackNext;
+    int stackHead;
+    unsigned int seed;
+    int *freeFrames;
+    int numFree;
+    int resident;
+    struct radixStruct pageTable;
+    int local;
+    int procCount;
+    int procResident[MAXPROCS];
+    int procFaults[MAXPROCS];
+    int hugeThreshold;
+    struct radixStruct regionResident;
+    struct radixStruct regionHuge;
+    int hugePages;
+    int hugeCovered;
+    int promotions;
+    int splits;
+    int hugeFills;
+    double reachSum;
+    int reachSamples;
+    int tlbEntries;
+    int tlbWays;
+    int tlbRandom;
+    int walkCycles;
+    unsigned long long *tlbTag;
+    unsigned int *tlbStamp;
+    unsigned int tlbClock;
+    unsigned int tlbSeed;
+    int tlbHits;
+    int tlbWalks;
+    int cacheLevels;
+    int writeThrough;
+    struct cacheStruct cache[CACHELEVELS];
+    int memReads;
+    int memWrites;
+    int flushInterval;
+    int flushBatch;
+    long long diskLatency;
+    int flushHand;
+    int cleaned;
+    long long simTime;
+    long long diskFree;
+    int diskQueue;
+    long long serviceTime;
+    long long plainService;
+    int plainFaults;
+    int costModel;
+    int hitNs;
+    int cleanNs;
+    int dirtyNs;
+    int victimDirty;
+    int dirtyFaults;
+    int window;
+    int windowFaults;
+    struct windowStruct *timeline;
+    int timeLen;
+    struct prefetchStruct *prefetch;
+    int prefetchDegree;
+    int prefetching;
+    unsigned long long strideLast;
+    long long strideDelta;
+    unsigned long long markovLast;
+    unsigned long long *markovTag;
+    unsigned long long *markovNext;
+    int prefetches;
+    int usefulPrefetches;
+    int wastedPrefetches;
+    int *heap;
+    int *heapPos;
+    int heapSize;
+    int hits;
+    int faults;
+    int writes;
+    int clocks;
+};
+
+struct policyStruct policies[] = {
+    {"opt", 1, 0, init_heap, NULL, lookup_page, opt_hit, opt_fill, my_opt, opt_before},
+    {"clock", 0, 0, NULL, NULL, lookup_page, clock_hit, clock_hit, my_clock, NULL},
+    {"aging", 0, 'r', init_aging, aging_tick, lookup_page, aging_hit, aging_fill, my_aging, NULL},
+    {"work", 0, 't', NULL, NULL, lookup_page, clock_hit, clock_hit, my_wsclock, NULL},
+    {"lru", 0, 0, init_list, NULL, lookup_page, lru_hit, list_fill, my_lru, NULL},
+    {"fifo", 0, 0, init_list, NULL, lookup_page, fifo_hit, list_fill, my_fifo, NULL},
+    {"random", 0, 0, NULL, NULL, lookup_page, fifo_hit, fifo_hit, my_random, NULL},
+    {"nru", 0, 'r', NULL, nru_tick, lookup_page, clock_hit, clock_hit, my_nru, NULL},
+    {"second", 0, 0, init_list, NULL, lookup_page, clock_hit, second_fill, my_second, NULL},
+    {"arc", 0, 0, init_arc, NULL, ghost_lookup, arc_hit, arc_fill, my_arc, NULL},
+    {"car", 0, 0, init_arc, NULL, ghost_lookup, clock_hit, car_fill, my_car, NULL},
+    {"clockpro", 0, 0, init_clockpro, NULL, ghost_lookup, clock_hit, clockpro_fill, my_clockpro, NULL},
+    {"2q", 0, 0, init_2q, NULL, ghost_lookup, twoq_hit, twoq_fill, my_2q, NULL},
+    {"lirs", 0, 0, init_lirs, NULL, ghost_lookup, lirs_hit, lirs_fill, my_lirs, NULL},
+    {NULL}
+};
+
+struct prefetchStruct prefetchers[] = {
+    {"seq", NULL, seq_predict},
+    {"stride", NULL, stride_predict},
+    {"markov", init_markov, markov_predict},
+    {NULL}
 };
 
-int numframes = 0;
-int algorithm = 0;
-int refresh = 0;
-int tau = 0;
 int totalAccess = 0;
 struct accessStruct *accessArray = NULL;
-struct frameStruct *frameArray = NULL;
-int hits = 0;
-int faults = 0;
-int writes = 0;
-int clocks = 0;
+int *nextUse = NULL;
+struct simStruct *sweepList = NULL;
+int sweepCount = 0;
+int nextSim = 0;
+pthread_mutex_t sweepLock = PTHREAD_MUTEX_INITIALIZER;
+int benchmark = 0;
+double parseTime = 0;
+long long parseBytes = 0;
+signed char hexValue[256];
+int pageBits = PAGEBITS;
+unsigned int procIds[MAXPROCS];
+int numProcs = 0;
+int lastProc = 0;
 
 int main(int argc, char *argv[]) {
-    int opt;
+    int opt, i;
+    int maxframes;
+    int numsims;
+    struct simStruct *sims;
+    int tune = 0;
+    int refresh = 0;
+    int tau = 0;
+    int width = 8;
+    unsigned int seed = 1;
+    int local = 0;
+    int huge = 0;
+    int tlbEntries = 0;
+    int tlbWays = 0;
+    int tlbRandom = 0;
+    int walkCycles = WALKCYCLES;
+    int cacheLevels = 0;
+    int writeThrough = 0;
+    struct cacheStruct cache[CACHELEVELS];
+    int flushInterval = 0;
+    int flushBatch = FLUSHBATCH;
+    int diskLatency = DISKLATENCY;
+    int costModel = 0;
+    int hitNs = HITNS;
+    int cleanNs = CLEANNS;
+    int dirtyNs = DIRTYNS;
+    int window = WINDOW;
+    char *timefile = NULL;
+    struct prefetchStruct *prefetch = NULL;
+    int prefetchDegree = PREFETCHMAX;
+    int runs;
+    struct policyStruct *policy = NULL;
+    char *frames = NULL;
     char *algo = NULL;
     char *tracefile = NULL;
+    char *binfile = NULL;
+    struct option longopts[] = {
+        {"convert", required_argument, NULL, 'c'},
+        {"tune", no_argument, NULL, 'T'},
+        {"tlb", required_argument, NULL, 'L'},
+        {"cache", required_argument, NULL, 'C'},
+        {"write-through", no_argument, NULL, 'W'},
+        {"flush", required_argument, NULL, 'F'},
+        {"cost", required_argument, NULL, 'M'},
+        {"timeline", required_argument, NULL, 'G'},
+        {"prefetch", required_argument, NULL, 'P'},
+        {NULL, 0, NULL, 0}
+    };
 
-    while ((opt = getopt(argc, argv, "n:a:r:t:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "n:a:r:t:w:s:lp:H:b", longopts, NULL)) != -1) {
         switch (opt) {
             case 'n':
-                numframes = atoi(optarg);
+                frames = optarg;
                 break;
             case 'a':
                 algo = optarg;
@@ -63,307 +532,2884 @@ int main(int argc, char *argv[]) {
             case 't':
                 tau = atoi(optarg);
                 break;
+            case 'w':
+                width = atoi(optarg);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                local = 1;
+                break;
+            case 'p':
+                pageBits = parse_size(optarg);
+                break;
+            case 'H':
+                huge = atoi(optarg);
+                break;
+            case 'b':
+                benchmark = 1;
+                break;
+            case 'c':
+                binfile = optarg;
+                break;
+            case 'T':
+                tune = 1;
+                break;
+            case 'L':
+                parse_tlb(optarg, &tlbEntries, &tlbWays, &tlbRandom, &walkCycles);
+                break;
+            case 'C':
+                parse_cache(optarg, cache, &cacheLevels);
+                break;
+            case 'W':
+                writeThrough = 1;
+                break;
+            case 'F':
+                parse_flush(optarg, &flushInterval, &flushBatch, &diskLatency);
+                break;
+            case 'M':
+                parse_cost(optarg, &hitNs, &cleanNs, &dirtyNs);
+                costModel = 1;
+                break;
+            case 'G':
+                timefile = parse_timeline(optarg, &window);
+                costModel = 1;
+                break;
+            case 'P':
+                prefetch = parse_prefetch(optarg, &prefetchDegree);
+                break;
             default:
                 fprintf(stderr,\
-                    "Usage: %s -n numframes -a opt|clock|aging|work [-r refresh] [-t tau] tractfile\n",\
-                    argv[0]);
+                    "Usage: %s -n numframes[,numframes...] -a opt|clock|aging|work|lru|fifo|random|nru|second\n"\
+                    "          |arc|car|clockpro|2q|lirs|stack\n"\
+                    "          [-r refresh] [-t tau] [-w 8|16|32|64] [-s seed] [-l] [-p 4K..2M] [-H threshold] [-b]\n"\
+                    "          [--tlb entries[,ways[,lru|random[,walkcycles]]]]\n"\
+                    "          [--cache size/ways[,size/ways[,size/ways]] [--write-through]]\n"\
+                    "          [--flush interval[,batch[,latency]]] [--cost hit[,clean[,dirty]]]\n"\
+                    "          [--timeline csvfile[,window]] [--prefetch seq|stride|markov[,degree]] tractfile\n"\
+                    "       %s --tune -n numframes[,numframes...] -a aging|work|nru tracefile\n"\
+                    "       %s --convert binfile tracefile\n",\
+                    argv[0], argv[0], argv[0]);
                 exit(EXIT_FAILURE);
         }
     }
     tracefile = argv[optind];
-    if (!strcmp(algo, "opt")) {
-        algorithm = OPT;
+    if (binfile) {
+        convert_tracefile(tracefile, binfile);
+        return 0;
+    }
+    if (!algo) {
+        exit(1);
     }
-    else if (!strcmp(algo, "clock")) {
-        algorithm = CLOCK;
+    for (i = 0; policies[i].name; i++) {
+        if (!strcmp(algo, policies[i].name)) {
+            policy = &policies[i];
+        }
     }
-    else if (!strcmp(algo, "aging")) {
-        algorithm = AGING;
+    if (!policy && strcmp(algo, "stack")) {
+        exit(1);
     }
-    else if (!strcmp(algo, "work")) {
-        algorithm = WSCLOCK;
+    if (tune && (!policy || !policy->param)) {
+        exit(1);
     }
-    else {
+    if (local && (!policy || (policy->fault != my_clock && policy->fault != my_wsclock))) {
+        exit(1);
+    }
+    if (width != 8 && width != 16 && width != 32 && width != 64) {
+        exit(1);
+    }
+    if (pageBits < PAGEBITS || pageBits > HUGEBITS) {
+        exit(1);
+    }
+    if (huge < 0 || (huge && (pageBits == HUGEBITS || huge > 1 << REGIONSHIFT))) {
+        exit(1);
+    }
+    if (timefile && (tune || !policy)) {
+        exit(1);
+    }
+    if ((prefetch || huge) && (!policy || policy->future)) {
         exit(1);
     }
     //printf("%d\t%s\t%s\n", numframes, algo, tracefile);
+    if (!frames) {
+        exit(1);
+    }
 
-    read_tracefile(tracefile);
-    init_frame();
-    access_frame();
-    printf("%s\n", algo);
-    printf("Number of frames:\t%d\n", numframes);
-    printf("Total memory accesses:\t%d\n", totalAccess);
-    printf("Total page faults:\t%d\n", faults);
-    printf("Total page hits:\t%d\n", hits);
-    printf("Total writes to disk:\t%d\n", writes);
+    numsims = 1;
+    for (i = 0; frames[i]; i++) {
+        if (frames[i] == ',') {
+            numsims++;
+        }
+    }
+    sims = (struct simStruct*)calloc(numsims, sizeof(struct simStruct));
+    if (!sims) {
+        exit(1);
+    }
+    for (i = 0; i < numsims; i++) {
+        sims[i].policy = policy;
+        sims[i].refresh = refresh;
+        sims[i].tau = tau;
+        sims[i].ageWidth = width;
+        sims[i].seed = seed;
+        sims[i].local = local;
+        sims[i].hugeThreshold = huge;
+        sims[i].tlbEntries = tlbEntries;
+        sims[i].tlbWays = tlbWays;
+        sims[i].tlbRandom = tlbRandom;
+        sims[i].walkCycles = walkCycles;
+        sims[i].tlbSeed = seed;
+        sims[i].cacheLevels = cacheLevels;
+        sims[i].writeThrough = writeThrough;
+        memcpy(sims[i].cache, cache, sizeof(cache));
+        sims[i].flushInterval = flushInterval;
+        sims[i].flushBatch = flushBatch;
+        sims[i].diskLatency = flushInterval ? diskLatency*1000LL : 0;
+        sims[i].costModel = costModel;
+        sims[i].hitNs = hitNs;
+        sims[i].cleanNs = cleanNs;
+        sims[i].dirtyNs = dirtyNs;
+        sims[i].window = timefile ? window : 0;
+        sims[i].prefetch = prefetch;
+        sims[i].prefetchDegree = prefetchDegree;
+        sims[i].numframes = atoi(frames);
+        if (sims[i].numframes <= 0) {
+            exit(1);
+        }
+        if (i < numsims-1) {
+            frames = strchr(frames, ',')+1;
+        }
+    }
+
+    // With the cleaner on, every configuration is run a second time with
+    // the same disk but no cleaner, to compare fault service times.
+    runs = numsims;
+    if (flushInterval && policy && !tune) {
+        runs = 2*numsims;
+        sims = (struct simStruct*)realloc(sims, runs*sizeof(struct simStruct));
+        if (!sims) {
+            exit(1);
+        }
+        memcpy(sims+numsims, sims, numsims*sizeof(struct simStruct));
+        for (i = numsims; i < runs; i++) {
+            sims[i].flushInterval = 0;
+            sims[i].window = 0;
+        }
+    }
+
+    if (!policy) {
+        maxframes = 0;
+        for (i = 0; i < numsims; i++) {
+            if (sims[i].numframes > maxframes) {
+                maxframes = sims[i].numframes;
+            }
+        }
+        read_tracefile(tracefile);
+        init_next();
+        stack_distance(maxframes);
+        numsims = 0;
+    }
+    else if (tune) {
+        read_tracefile(tracefile);
+        tune_policy(sims, numsims);
+        numsims = 0;
+    }
+    else if (numsims > 1) {
+        read_tracefile(tracefile);
+        if (policy->future) {
+            init_next();
+        }
+        run_sims(sims, runs);
+    }
+    else if (policy->future) {
+        read_tracefile(tracefile);
+        init_next();
+        for (i = 0; i < runs; i++) {
+            init_frame(&sims[i]);
+            access_frame(&sims[i]);
+        }
+    }
+    else {
+        for (i = 0; i < runs; i++) {
+            init_frame(&sims[i]);
+        }
+        stream_tracefile(sims, runs, tracefile);
+    }
+    for (i = 0; i < numsims; i++) {
+        if (runs > numsims) {
+            sims[i].plainService = sims[numsims+i].serviceTime;
+            sims[i].plainFaults = sims[numsims+i].faults;
+        }
+        print_summary(&sims[i]);
+    }
+    if (timefile) {
+        write_timeline(timefile, sims, numsims);
+    }
+    for (i = 0; i < runs; i++) {
+        free_frame(&sims[i]);
+        free(sims[i].timeline);
+    }
+    if (benchmark) {
+        fprintf(stderr, "Parsed %.1f MB in %.3f s (%.1f MB/s)\n",\
+            parseBytes/1e6, parseTime, parseTime > 0 ? parseBytes/1e6/parseTime : 0);
+    }
     free(accessArray);
-    free(frameArray);
+    free(nextUse);
+    free(sims);
     return 0;
 }
 
-void read_access(int i, unsigned int addr, unsigned char mode) {
-    accessArray[i].offset = addr & 0xfff;
-    accessArray[i].index = addr >> 12;
-    accessArray[i].mode = mode;
+void print_summary(struct simStruct *sim) {
+    int i;
+    printf("%s\n", sim->policy->name);
+    printf("Number of frames:\t%d\n", sim->numframes);
+    printf("Total memory accesses:\t%d\n", totalAccess);
+    printf("Total page faults:\t%d\n", sim->faults);
+    printf("Total page hits:\t%d\n", sim->hits);
+    printf("Total writes to disk:\t%d\n", sim->writes);
+    if (numProcs > 1) {
+        for (i = 0; i < numProcs; i++) {
+            printf("Process %u page faults:\t%d\n", procIds[i], sim->procFaults[i]);
+        }
+    }
+    if (sim->hugeThreshold) {
+        double reach = sim->reachSamples ? sim->reachSum/sim->reachSamples : 0;
+        printf("Pages filled in by promotions:\t%d\n", sim->hugeFills);
+        printf("Huge page promotions:\t%d\n", sim->promotions);
+        printf("Huge page splits:\t%d\n", sim->splits);
+        printf("Huge pages resident:\t%d\n", sim->hugePages);
+        printf("TLB reach per entry:\t%.1f KiB (%.1fx)\n", reach/1024, reach/(1 << pageBits));
+    }
+    if (sim->tlbEntries) {
+        printf("TLB hit rate:\t%.2f%%\n", totalAccess ? 100.0*sim->tlbHits/totalAccess : 0);
+        printf("TLB page walks:\t%d\n", sim->tlbWalks);
+        printf("Estimated translation cycles:\t%lld\n", totalAccess+(long long)sim->tlbWalks*sim->walkCycles);
+    }
+    for (i = 0; i < sim->cacheLevels; i++) {
+        printf("L%d cache miss rate:\t%.2f%% (%d of %d)\n", i+1,\
+            sim->cache[i].accesses ? 100.0*sim->cache[i].misses/sim->cache[i].accesses : 0,\
+            sim->cache[i].misses, sim->cache[i].accesses);
+    }
+    if (sim->cacheLevels) {
+        printf("Memory line reads:\t%d\n", sim->memReads);
+        printf("Memory line writes:\t%d\n", sim->memWrites);
+    }
+    if (sim->flushInterval) {
+        printf("Pages written by cleaner:\t%d\n", sim->cleaned);
+        printf("Fault service time:\t%.1f us\n", sim->faults ? sim->serviceTime/1e3/sim->faults : 0);
+        printf("Fault service time without cleaner:\t%.1f us\n",\
+            sim->plainFaults ? sim->plainService/1e3/sim->plainFaults : 0);
+    }
+    if (sim->prefetch) {
+        printf("Pages prefetched:\t%d\n", sim->prefetches);
+        printf("Useful prefetches:\t%d\n", sim->usefulPrefetches);
+        printf("Wasted prefetches:\t%d\n", sim->wastedPrefetches);
+    }
+    if (sim->costModel) {
+        printf("Faults with a dirty victim:\t%d\n", sim->dirtyFaults);
+        printf("Simulated time:\t%.6f s\n", sim_time(sim, totalAccess)/1e9);
+    }
 }
 
-void read_tracefile(char *tracefile) {
-    FILE *file = fopen(tracefile, "rb");
-    if (!file) {
-        exit(1);
+// --prefetch name[,degree]. degree caps the pages loaded per prediction,
+// and is the largest window readahead grows to.
+struct prefetchStruct *parse_prefetch(char *arg, int *degree) {
+    char *p = strchr(arg, ',');
+    int i;
+    if (p) {
+        *p = 0;
+        *degree = strtol(p+1, &p, 0);
+        if (*p || *degree <= 0) {
+            exit(1);
+        }
+    }
+    for (i = 0; prefetchers[i].name; i++) {
+        if (!strcmp(arg, prefetchers[i].name)) {
+            return &prefetchers[i];
+        }
     }
+    exit(1);
+}
 
-    unsigned int addr = 0;
-    unsigned char mode = 0;
-    int size = 0;
-    while (fscanf(file, "%x %c", &addr, &mode) == 2) {
-        totalAccess++;
+// --cost hit[,clean[,dirty]]: nanoseconds for a hit, a fault whose victim
+// is clean or free, and a fault that must write its victim out first.
+void parse_cost(char *arg, int *hit, int *clean, int *dirty) {
+    char *p = arg;
+    *hit = strtol(p, &p, 0);
+    if (*p == ',') {
+        *clean = strtol(p+1, &p, 0);
     }
-    rewind(file);
-    accessArray = (struct accessStruct*)malloc(totalAccess*sizeof(struct accessStruct));
-    if (!accessArray) {
+    if (*p == ',') {
+        *dirty = strtol(p+1, &p, 0);
+    }
+    if (*p || *hit < 0 || *clean < 0 || *dirty < 0) {
         exit(1);
     }
+}
+
+// --timeline file[,window]: the CSV file to write, with window references
+// to a row.
+char *parse_timeline(char *arg, int *window) {
+    char *p = strrchr(arg, ',');
+    if (p) {
+        *p = 0;
+        *window = strtol(p+1, &p, 0);
+        if (*p || *window <= 0) {
+            exit(1);
+        }
+    }
+    return arg;
+}
 
-    int i = 0;
-    while (fscanf(file, "%x %c", &addr, &mode) == 2) {
-        read_access(i, addr, mode);
-        i++;
+// Simulated time for the first refs references, from the cost model.
+// With --flush the disk model keeps the clock instead, so faults cost what
+// they waited for the disk rather than the fixed clean and dirty costs, and
+// the time agrees with the fault service times reported beside it.
+long long sim_time(struct simStruct *sim, int refs) {
+    if (sim->diskLatency) {
+        return sim->simTime;
     }
+    return (long long)(refs-sim->faults)*sim->hitNs\
+        +(long long)(sim->faults-sim->dirtyFaults)*sim->cleanNs\
+        +(long long)sim->dirtyFaults*sim->dirtyNs;
+}
 
-    fclose(file);
+// Close the window of references before end. Dirty pages are counted by
+// a scan of the frames, which is cheap once per window.
+void timeline_add(struct simStruct *sim, int end) {
+    struct windowStruct *w;
+    int j;
+    if (sim->timeLen && sim->timeline[sim->timeLen-1].end == end) {
+        return;
+    }
+    if (!(sim->timeLen & (sim->timeLen-1))) {
+        sim->timeline = (struct windowStruct*)realloc(sim->timeline,\
+            (sim->timeLen ? 2*sim->timeLen : 1)*sizeof(struct windowStruct));
+        if (!sim->timeline) {
+            exit(1);
+        }
+    }
+    w = &sim->timeline[sim->timeLen++];
+    w->end = end;
+    w->faults = sim->faults-sim->windowFaults;
+    w->dirty = 0;
+    for (j = 0; j < sim->numframes; j++) {
+        w->dirty += (sim->frameFlags[j] & (VALID | DIRTY)) == (VALID | DIRTY);
+    }
+    w->time = sim_time(sim, end);
+    sim->windowFaults = sim->faults;
 }
 
-void init_frame() {
-    frameArray = (struct frameStruct*)malloc(numframes*sizeof(struct frameStruct));
-    if (!frameArray) {
+// The timelines of every simulation in list, one CSV row per window.
+void write_timeline(char *file, struct simStruct *list, int n) {
+    FILE *out = fopen(file, "w");
+    int i, k;
+    if (!out) {
         exit(1);
     }
-
-    int i;
-    for (i = 0; i < numframes; i++) {
-        frameArray[i].valid = 0;
-        frameArray[i].dirty = 0;
-        frameArray[i].referenced = 0;
-        frameArray[i].tim = 0;
+    fprintf(out, "policy,frames,references,faults,dirty_pages,time_ns\n");
+    for (i = 0; i < n; i++) {
+        for (k = 0; k < list[i].timeLen; k++) {
+            fprintf(out, "%s,%d,%d,%d,%d,%lld\n", list[i].policy->name, list[i].numframes,\
+                list[i].timeline[k].end, list[i].timeline[k].faults, list[i].timeline[k].dirty,\
+                list[i].timeline[k].time);
+        }
     }
+    fclose(out);
 }
 
-void access_frame() {
-    int i, j, empty;
-    unsigned int index;
-    unsigned char mode;
-    for (i = 0; i < totalAccess; i++) {
-        index = accessArray[i].index;
-        //printf("%d\n", index);
-        mode = accessArray[i].mode;
-        empty = -1;
+// --flush interval[,batch[,latency]], with the interval in references and
+// the disk latency per page in microseconds. A nonzero latency is what
+// turns the disk model on, so a latency of 0 is refused.
+void parse_flush(char *arg, int *interval, int *batch, int *latency) {
+    char *p = arg;
+    *interval = strtol(p, &p, 0);
+    if (*p == ',') {
+        *batch = strtol(p+1, &p, 0);
+    }
+    if (*p == ',') {
+        *latency = strtol(p+1, &p, 0);
+    }
+    if (*p || *interval <= 0 || *batch <= 0 || *latency <= 0) {
+        exit(1);
+    }
+}
 
-        if (algorithm == AGING && i%refresh == 0) {
-            for (j = 0; j < numframes; j++) {
-                frameArray[j].referenced >>= 1;
-            }
+// --tlb entries[,ways[,lru|random[,walkcycles]]]. Ways default to 4, or
+// fewer if the TLB is smaller.
+void parse_tlb(char *arg, int *entries, int *ways, int *random, int *walk) {
+    char *p = arg;
+    *entries = strtol(p, &p, 0);
+    *ways = *entries < 4 ? *entries : 4;
+    if (*p == ',') {
+        *ways = strtol(p+1, &p, 0);
+    }
+    if (*p == ',') {
+        p++;
+        if (!strncmp(p, "random", 6)) {
+            *random = 1;
+            p += 6;
         }
-
-        for (j = 0; j < numframes; j++) {
-            if (frameArray[j].valid) {
-                if (frameArray[j].index == index) {
-                    hits++;
-                    //printf("%x\t Hit\n", index);
-                    if (mode == 'W') {
-                        frameArray[j].dirty = 1;
-                    }
-                    if (algorithm == OPT) {
-                        frameArray[j].tim = find_next(i, index);
-                    }
-                    if (algorithm == CLOCK || algorithm == WSCLOCK) {
-                        frameArray[j].referenced = 1;
-                    }
-                    if (algorithm == AGING) {
-                        frameArray[j].referenced |= 0x80;
-                    }
-                    empty = 0;
-                    break;
-                }
-            }
-            else {
-                empty = 1;
-                break;
-            }
+        else if (!strncmp(p, "lru", 3)) {
+            p += 3;
         }
+    }
+    if (*p == ',') {
+        *walk = strtol(p+1, &p, 0);
+    }
+    if (*p || *entries <= 0 || *ways <= 0 || *entries%*ways || *walk < 0) {
+        exit(1);
+    }
+}
 
-        if (empty == 1) {
-            faults++;
-            frameArray[j].valid = 1;
-            frameArray[j].index = index;
-            if (algorithm == OPT) {
-                frameArray[j].tim = find_next(i, index);
-            }
-            if (algorithm == CLOCK || algorithm == WSCLOCK) {
-                frameArray[j].referenced = 1;
-            }
-            if (algorithm == AGING) {
-                frameArray[j].referenced = 0x80;
-            }
-            if (mode == 'W') {
-                frameArray[j].dirty = 1;
-            }
+// --cache size/ways[,size/ways...] from L1 outward, with sizes in bytes
+// and an optional K or M suffix. Lines are 1 << LINEBITS bytes.
+void parse_cache(char *arg, struct cacheStruct *cache, int *levels) {
+    char *p = arg;
+    struct cacheStruct *c;
+    *levels = 0;
+    while (1) {
+        if (*levels == CACHELEVELS) {
+            exit(1);
         }
-        else if (empty == -1) {
-            faults++;
-            //printf("%x\t Miss\n", index);
-            switch (algorithm) {
-                case OPT:
-                    my_opt(i, index, mode);
-                    break;
-                case CLOCK:
-                    my_clock(index, mode);
-                    break;
-                case AGING:
-                    my_aging(index, mode);
-                    break;
-                case WSCLOCK:
-                    my_wsclock(i, index, mode);
-                    break;
-            }
+        c = &cache[(*levels)++];
+        c->size = strtol(p, &p, 0);
+        if (*p == 'K' || *p == 'k') {
+            c->size <<= 10;
+            p++;
+        }
+        else if (*p == 'M' || *p == 'm') {
+            c->size <<= 20;
+            p++;
         }
+        if (*p != '/') {
+            exit(1);
+        }
+        c->ways = strtol(p+1, &p, 0);
+        if (c->size <= 0 || c->ways <= 0 || c->size%(c->ways << LINEBITS)) {
+            exit(1);
+        }
+        c->sets = c->size/(c->ways << LINEBITS);
+        if (*p != ',') {
+            break;
+        }
+        p++;
+    }
+    if (*p) {
+        exit(1);
     }
 }
 
-void my_opt(int cur, unsigned int index, unsigned char mode) {
-    int i;
-    unsigned int max = 0;
-    int j = -1;
-    for (i = 0; i < numframes; i++) {
-        if (frameArray[i].tim > max) {
-            max = frameArray[i].tim;
-            j = i;
-        }
+// A page size in bytes, with an optional K or M suffix, as a shift.
+int parse_size(char *arg) {
+    char *end;
+    unsigned long size = strtoul(arg, &end, 0);
+    int bits = 0;
+    if (*end == 'K' || *end == 'k') {
+        size <<= 10;
     }
-    frameArray[j].index = index;
-    if (frameArray[j].dirty) {
-        writes++;
+    else if (*end == 'M' || *end == 'm') {
+        size <<= 20;
     }
-    if (mode == 'R') {
-        frameArray[j].dirty = 0;
+    while ((1UL << bits) < size) {
+        bits++;
     }
-    else if (mode == 'W') {
-        frameArray[j].dirty = 1;
+    if ((1UL << bits) != size) {
+        exit(1);
     }
-    frameArray[j].tim = find_next(cur, index);
+    return bits;
 }
 
-int find_next(int cur, unsigned int index) {
+// Simulate every entry of list over the loaded trace, spread across one
+// worker thread per online CPU.
+void run_sims(struct simStruct *list, int n) {
     int i;
-    for (i = cur+1; i < totalAccess; i++) {
-        if (index == accessArray[i].index) {
-            return i;
+    int numthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t *threads;
+    if (numthreads > n) {
+        numthreads = n;
+    }
+    if (numthreads < 1) {
+        numthreads = 1;
+    }
+    threads = (pthread_t*)malloc(numthreads*sizeof(pthread_t));
+    if (!threads) {
+        exit(1);
+    }
+
+    sweepList = list;
+    sweepCount = n;
+    nextSim = 0;
+    for (i = 0; i < numthreads; i++) {
+        if (pthread_create(&threads[i], NULL, run_sweep, NULL)) {
+            exit(1);
         }
     }
-    return totalAccess;
+    for (i = 0; i < numthreads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
 }
 
-void my_clock(unsigned int index, unsigned char mode) {
-    int i = clocks;
+// Sweep workers claim the next unsimulated entry until none are left.
+void *run_sweep(void *arg) {
+    int i;
     while (1) {
-        if (!frameArray[i].referenced) {
-            frameArray[i].index = index;
-            frameArray[i].referenced = 1;
-            if (frameArray[i].dirty) {
-                writes++;
-            }
-            if (mode == 'R') {
-                frameArray[i].dirty = 0;
+        pthread_mutex_lock(&sweepLock);
+        i = nextSim++;
+        pthread_mutex_unlock(&sweepLock);
+        if (i >= sweepCount) {
+            break;
+        }
+        init_frame(&sweepList[i]);
+        access_frame(&sweepList[i]);
+        free_frame(&sweepList[i]);
+    }
+    return NULL;
+}
+
+void set_param(struct simStruct *sim, int value) {
+    if (sim->policy->param == 'r') {
+        sim->refresh = value;
+    }
+    else {
+        sim->tau = value;
+    }
+}
+
+// Search the policy's parameter for each frame count in base: a coarse pass
+// over powers of two up to the trace length, then TUNESTEPS evenly spaced
+// values between half and double the best of those. Fewest faults wins,
+// then fewest writes.
+void tune_policy(struct simStruct *base, int n) {
+    struct simStruct *list;
+    struct simStruct *sim;
+    struct simStruct *result = (struct simStruct*)malloc(n*sizeof(struct simStruct));
+    int *best = (int*)malloc(n*sizeof(int));
+    int coarse = 1;
+    int i, k, v, lo, hi, count, pass;
+    if (!result || !best) {
+        exit(1);
+    }
+    for (v = 1; v <= totalAccess/2; v *= 2) {
+        coarse++;
+    }
+    count = coarse > TUNESTEPS ? coarse : TUNESTEPS;
+    list = (struct simStruct*)malloc(n*count*sizeof(struct simStruct));
+    if (!list) {
+        exit(1);
+    }
+
+    for (pass = 0; pass < 2; pass++) {
+        count = pass ? TUNESTEPS : coarse;
+        for (i = 0; i < n; i++) {
+            lo = pass && best[i] > 2 ? best[i]/2 : 1;
+            hi = pass ? best[i]*2 : 1;
+            for (k = 0; k < count; k++) {
+                sim = &list[i*count+k];
+                *sim = base[i];
+                set_param(sim, pass ? lo+(int)((long long)(hi-lo)*k/(count-1)) : 1 << k);
             }
-            else if (mode == 'W') {
-                frameArray[i].dirty = 1;
+        }
+        run_sims(list, n*count);
+        for (i = 0; i < n; i++) {
+            sim = &list[i*count];
+            for (k = 1; k < count; k++) {
+                if (list[i*count+k].faults < sim->faults\
+                        || (list[i*count+k].faults == sim->faults && list[i*count+k].writes < sim->writes)) {
+                    sim = &list[i*count+k];
+                }
             }
+            result[i] = *sim;
+            best[i] = sim->policy->param == 'r' ? sim->refresh : sim->tau;
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        printf("%s\n", result[i].policy->name);
+        printf("Number of frames:\t%d\n", result[i].numframes);
+        printf("Best %s:\t%d\n", result[i].policy->param == 'r' ? "refresh" : "tau", best[i]);
+        printf("Total page faults:\t%d\n", result[i].faults);
+        printf("Total writes to disk:\t%d\n", result[i].writes);
+    }
+    free(list);
+    free(result);
+    free(best);
+}
+
+void read_access(int i, int proc, unsigned long long addr, unsigned char mode) {
+    accessArray[i].offset = addr & ((1 << pageBits)-1);
+    accessArray[i].index = ((unsigned long long)proc << PROCSHIFT) | (addr >> pageBits);
+    accessArray[i].mode = mode;
+}
+
+// Number processes densely in the order their PIDs first appear. Lines
+// without a PID belong to PID 0.
+int proc_slot(unsigned int pid) {
+    int i;
+    if (lastProc < numProcs && procIds[lastProc] == pid) {
+        return lastProc;
+    }
+    for (i = 0; i < numProcs; i++) {
+        if (procIds[i] == pid) {
             break;
         }
-        else {
-            frameArray[i].referenced = 0;
+    }
+    if (i == numProcs) {
+        if (numProcs == MAXPROCS) {
+            exit(1);
         }
-        i = (i+1)%numframes;
+        procIds[numProcs++] = pid;
     }
-    clocks = (i+1)%numframes;
+    lastProc = i;
+    return i;
 }
 
-void my_aging(unsigned int index, unsigned char mode) {
+void open_trace(struct traceStruct *trace, char *tracefile) {
     int i;
-    unsigned int min = 0x100;
-    int j = -1;
-    for (i = 0; i < numframes; i++) {
-        if (frameArray[i].referenced < min) {
-            min = frameArray[i].referenced;
-            j = i;
+    trace->fd = open(tracefile, O_RDONLY);
+    if (trace->fd < 0) {
+        exit(1);
+    }
+    trace->buf = (unsigned char*)malloc(READBUF+1);
+    if (!trace->buf) {
+        exit(1);
+    }
+    trace->pos = 0;
+    trace->len = 0;
+    trace->eof = 0;
+    trace->bytes = 0;
+    trace->buf[0] = 0;
+    trace->map = NULL;
+    trace->records = NULL;
+    trace->next = 0;
+    trace->gz = NULL;
+
+    struct stat st;
+    unsigned int magic = 0;
+    if (fstat(trace->fd, &st) || read(trace->fd, &magic, sizeof(magic)) != sizeof(magic)) {
+        magic = 0;
+    }
+    lseek(trace->fd, 0, SEEK_SET);
+    if ((magic == BINMAGIC || magic == BINMAGIC64) && st.st_size >= sizeof(struct binHeader)) {
+        trace->wide = magic == BINMAGIC64;
+        trace->mapSize = st.st_size;
+        trace->map = (struct binHeader*)mmap(NULL, trace->mapSize, PROT_READ, MAP_PRIVATE, trace->fd, 0);
+        if (trace->map == MAP_FAILED || trace->map->pageSize == 0 || trace->map->count > (trace->mapSize\
+                -sizeof(struct binHeader))/(trace->wide ? sizeof(unsigned long long) : sizeof(unsigned int))) {
+            exit(1);
+        }
+        // Records are page numbers at the page size they were written with;
+        // any larger page size can be had by shifting.
+        trace->shift = 0;
+        while ((trace->map->pageSize << trace->shift) < (1U << pageBits)) {
+            trace->shift++;
+        }
+        if ((trace->map->pageSize << trace->shift) != (1U << pageBits)) {
+            exit(1);
+        }
+        trace->records = trace->map+1;
+        proc_slot(0);
+    }
+    else if ((magic & 0xffff) == GZMAGIC) {
+        trace->gz = gzdopen(trace->fd, "rb");
+        if (!trace->gz) {
+            exit(1);
+        }
+        gzbuffer(trace->gz, READBUF);
+        for (i = 0; i < GZBUFS; i++) {
+            trace->gzBuf[i] = (unsigned char*)malloc(READBUF);
+            if (!trace->gzBuf[i]) {
+                exit(1);
+            }
+        }
+        trace->gzHead = 0;
+        trace->gzTail = 0;
+        trace->gzCount = 0;
+        trace->gzOff = 0;
+        trace->gzStop = 0;
+        pthread_mutex_init(&trace->lock, NULL);
+        pthread_cond_init(&trace->cond, NULL);
+        if (pthread_create(&trace->thread, NULL, inflate_trace, trace)) {
+            exit(1);
         }
     }
-    frameArray[j].index = index;
-    frameArray[j].referenced = 0x80;
-    if (frameArray[j].dirty) {
-        writes++;
+
+    for (i = 0; i < 256; i++) {
+        hexValue[i] = -1;
     }
-    if (mode == 'R') {
-        frameArray[j].dirty = 0;
+    for (i = 0; i < 10; i++) {
+        hexValue['0'+i] = i;
     }
-    else if (mode == 'W') {
-        frameArray[j].dirty = 1;
+    for (i = 0; i < 6; i++) {
+        hexValue['a'+i] = 10+i;
+        hexValue['A'+i] = 10+i;
     }
 }
 
-void my_wsclock(int cur, unsigned int index, unsigned char mode) {
-    int i = clocks;
-    int min = totalAccess;
-    int j, k;
+void close_trace(struct traceStruct *trace) {
+    int i;
+    parseBytes += trace->bytes;
+    if (trace->map) {
+        munmap(trace->map, trace->mapSize);
+    }
+    if (trace->gz) {
+        pthread_mutex_lock(&trace->lock);
+        trace->gzStop = 1;
+        pthread_cond_broadcast(&trace->cond);
+        pthread_mutex_unlock(&trace->lock);
+        pthread_join(trace->thread, NULL);
+        for (i = 0; i < GZBUFS; i++) {
+            free(trace->gzBuf[i]);
+        }
+        pthread_mutex_destroy(&trace->lock);
+        pthread_cond_destroy(&trace->cond);
+        gzclose(trace->gz);
+    }
+    else {
+        close(trace->fd);
+    }
+    free(trace->buf);
+}
+
+// Decompression runs on its own thread, filling up to GZBUFS buffers ahead
+// of the parser. A zero-length buffer marks the end of the stream.
+void *inflate_trace(void *arg) {
+    struct traceStruct *trace = (struct traceStruct*)arg;
+    int n;
     while (1) {
-        if (!frameArray[i].referenced) {
-            if (cur-frameArray[i].tim > tau) {
-                if (frameArray[i].dirty) {
-                    writes++;
-                    frameArray[i].dirty = 0;
-                }
-                else {
-                    frameArray[i].index = index;
-                    frameArray[i].referenced = 1;
-                    //frameArray[i].tim = cur;
-                    if (mode == 'R') {
-                        frameArray[i].dirty = 0;
-                    }
-                    else if (mode == 'W') {
-                        frameArray[i].dirty = 1;
-                    }
-                    break;
-                }
-            }
+        pthread_mutex_lock(&trace->lock);
+        while (trace->gzCount == GZBUFS && !trace->gzStop) {
+            pthread_cond_wait(&trace->cond, &trace->lock);
         }
-        else {
-            frameArray[i].tim = cur;
-            frameArray[i].referenced = 0;
-        }
-        i = (i+1)%numframes;
-        if (i == clocks) {
-            for (j = 0; j < numframes; j++) {
-                if (frameArray[(i+j)%numframes].tim < min) {
-                    min = frameArray[(i+j)%numframes].tim;
-                    k = (i+j)%numframes;
-                }
-            }
-            frameArray[k].index = index;
-            frameArray[k].referenced = 1;
-            //frameArray[k].tim = cur;
-            if (frameArray[k].dirty) {
-                writes++;
-            }
-            if (mode == 'R') {
-                frameArray[k].dirty = 0;
-            }
-            else if (mode == 'W') {
-                frameArray[k].dirty = 1;
-            }
-            i--;
+        if (trace->gzStop) {
+            pthread_mutex_unlock(&trace->lock);
+            break;
+        }
+        pthread_mutex_unlock(&trace->lock);
+
+        n = gzread(trace->gz, trace->gzBuf[trace->gzHead], READBUF);
+        if (n < 0) {
+            n = 0;
+        }
+
+        pthread_mutex_lock(&trace->lock);
+        trace->gzLen[trace->gzHead] = n;
+        trace->gzHead = (trace->gzHead+1)%GZBUFS;
+        trace->gzCount++;
+        pthread_cond_broadcast(&trace->cond);
+        pthread_mutex_unlock(&trace->lock);
+        if (n == 0) {
             break;
         }
     }
-    clocks = (i+1)%numframes;
+    return NULL;
+}
+
+// Like read(2) on the trace, taking bytes from the inflate thread for gzip
+// input. Returns 0 at the end of the trace.
+int read_bytes(struct traceStruct *trace, unsigned char *dst, int want) {
+    int n;
+    if (!trace->gz) {
+        return read(trace->fd, dst, want);
+    }
+
+    pthread_mutex_lock(&trace->lock);
+    while (trace->gzCount == 0) {
+        pthread_cond_wait(&trace->cond, &trace->lock);
+    }
+    pthread_mutex_unlock(&trace->lock);
+
+    n = trace->gzLen[trace->gzTail]-trace->gzOff;
+    if (n == 0) {
+        return 0;
+    }
+    if (n > want) {
+        n = want;
+    }
+    memcpy(dst, trace->gzBuf[trace->gzTail]+trace->gzOff, n);
+    trace->gzOff += n;
+    if (trace->gzOff == trace->gzLen[trace->gzTail]) {
+        trace->gzOff = 0;
+        pthread_mutex_lock(&trace->lock);
+        trace->gzTail = (trace->gzTail+1)%GZBUFS;
+        trace->gzCount--;
+        pthread_cond_broadcast(&trace->cond);
+        pthread_mutex_unlock(&trace->lock);
+    }
+    return n;
+}
+
+// Slide the unread tail to the front and top the buffer up. The byte past
+// the data is always 0, which stops every scan in read_chunk().
+void fill_trace(struct traceStruct *trace) {
+    int n;
+    memmove(trace->buf, trace->buf+trace->pos, trace->len-trace->pos);
+    trace->len -= trace->pos;
+    trace->pos = 0;
+    while (!trace->eof && trace->len < READBUF) {
+        n = read_bytes(trace, trace->buf+trace->len, READBUF-trace->len);
+        if (n <= 0) {
+            trace->eof = 1;
+        }
+        else {
+            trace->len += n;
+            trace->bytes += n;
+        }
+    }
+    trace->buf[trace->len] = 0;
+}
+
+// A line that runs into the end of the buffer before the file ends was
+// cut short by the refill threshold, whether by a run of blank lines or
+// an overlong line. Drop the blanks before it, read more and tell the
+// caller to parse it again. Lines longer than the whole buffer end the
+// trace.
+int refill_line(struct traceStruct *trace, unsigned char *line, unsigned char *p) {
+    if (p < trace->buf+trace->len || trace->eof) {
+        return 0;
+    }
+    trace->pos = line-trace->buf;
+    if (trace->len-trace->pos >= READBUF) {
+        return 0;
+    }
+    fill_trace(trace);
+    return 1;
+}
+
+// Parse up to max-start "%x %c" records into accessArray[start...] and
+// return how many were read; fewer than asked means the trace is over.
+// Multi-process traces put a decimal PID first on each line, "%u %x %c".
+int read_chunk(struct traceStruct *trace, int start, int max) {
+    double t = benchmark ? now() : 0;
+    unsigned char *p, *q, *line;
+    unsigned long long addr, r;
+    unsigned int pid;
+    int d;
+    int n = start;
+    if (trace->records) {
+        while (n < max && trace->next < trace->map->count) {
+            if (trace->wide) {
+                r = ((unsigned long long*)trace->records)[trace->next++];
+            }
+            else {
+                r = ((unsigned int*)trace->records)[trace->next++];
+            }
+            accessArray[n].index = (r >> 1) >> trace->shift;
+            accessArray[n].offset = 0;
+            accessArray[n].mode = (r & 1) ? 'W' : 'R';
+            n++;
+        }
+        trace->bytes += (n-start)*(trace->wide ? sizeof(unsigned long long) : sizeof(unsigned int));
+    }
+    while (n < max && !trace->records) {
+        if (trace->len-trace->pos < MAXLINE && !trace->eof) {
+            fill_trace(trace);
+        }
+        p = trace->buf+trace->pos;
+        while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') {
+            p++;
+        }
+        line = p;
+        if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+            p += 2;
+        }
+        if (hexValue[*p] < 0) {
+            if (refill_line(trace, line, p)) {
+                continue;
+            }
+            break;
+        }
+        q = p;
+        addr = 0;
+        while ((d = hexValue[*p]) >= 0) {
+            addr = (addr << 4) | d;
+            p++;
+        }
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        pid = 0;
+        if (hexValue[*p] >= 0) {
+            for (; q < p && *q >= '0' && *q <= '9'; q++) {
+                pid = pid*10+*q-'0';
+            }
+            if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+                p += 2;
+            }
+            addr = 0;
+            while ((d = hexValue[*p]) >= 0) {
+                addr = (addr << 4) | d;
+                p++;
+            }
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+        }
+        if (*p <= ' ') {
+            if (refill_line(trace, line, p)) {
+                continue;
+            }
+            break;
+        }
+        read_access(n, proc_slot(pid), addr, *p);
+        trace->pos = p+1-trace->buf;
+        n++;
+    }
+    if (benchmark) {
+        parseTime += now()-t;
+    }
+    return n-start;
+}
+
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+void read_tracefile(char *tracefile) {
+    struct traceStruct trace;
+    int size = CHUNK;
+    open_trace(&trace, tracefile);
+    accessArray = (struct accessStruct*)malloc(size*sizeof(struct accessStruct));
+    if (!accessArray) {
+        exit(1);
+    }
+
+    while (1) {
+        totalAccess += read_chunk(&trace, totalAccess, size);
+        if (totalAccess < size) {
+            break;
+        }
+        size *= 2;
+        accessArray = (struct accessStruct*)realloc(accessArray, size*sizeof(struct accessStruct));
+        if (!accessArray) {
+            exit(1);
+        }
+    }
+
+    close_trace(&trace);
+}
+
+// Only OPT needs future knowledge, so for the other policies the trace is
+// run through a fixed chunk of accessArray instead of being loaded whole.
+// Each chunk goes through every simulation in list before the next is read.
+void stream_tracefile(struct simStruct *list, int n, char *tracefile) {
+    struct traceStruct trace;
+    struct simStruct *sim;
+    open_trace(&trace, tracefile);
+    accessArray = (struct accessStruct*)malloc(CHUNK*sizeof(struct accessStruct));
+    if (!accessArray) {
+        exit(1);
+    }
+
+    int i, k, len;
+    do {
+        len = read_chunk(&trace, 0, CHUNK);
+        for (k = 0; k < n; k++) {
+            sim = &list[k];
+            for (i = 0; i < len; i++) {
+                access_page(sim, totalAccess+i, accessArray[i].index, accessArray[i].offset, accessArray[i].mode);
+            }
+        }
+        totalAccess += len;
+    } while (len == CHUNK);
+    for (k = 0; k < n; k++) {
+        if (list[k].window && totalAccess) {
+            timeline_add(&list[k], totalAccess);
+        }
+    }
+
+    close_trace(&trace);
+}
+
+// Write the text trace out in the binary format read back by open_trace().
+// Binary traces hold a single process.
+void convert_tracefile(char *tracefile, char *binfile) {
+    struct traceStruct trace;
+    struct binHeader header;
+    unsigned long long r;
+    int i, n;
+    FILE *file = fopen(binfile, "wb");
+    if (!file) {
+        exit(1);
+    }
+    open_trace(&trace, tracefile);
+    accessArray = (struct accessStruct*)malloc(CHUNK*sizeof(struct accessStruct));
+    if (!accessArray) {
+        exit(1);
+    }
+
+    header.magic = BINMAGIC64;
+    header.pageSize = 1 << pageBits;
+    header.count = 0;
+    fwrite(&header, sizeof(header), 1, file);
+    do {
+        n = read_chunk(&trace, 0, CHUNK);
+        if (numProcs > 1) {
+            exit(1);
+        }
+        for (i = 0; i < n; i++) {
+            r = (accessArray[i].index << 1) | (accessArray[i].mode == 'W');
+            fwrite(&r, sizeof(r), 1, file);
+        }
+        header.count += n;
+    } while (n == CHUNK);
+    rewind(file);
+    fwrite(&header, sizeof(header), 1, file);
+
+    if (fclose(file)) {
+        exit(1);
+    }
+    close_trace(&trace);
+    free(accessArray);
+}
+
+void init_next() {
+    struct radixStruct last;
+    int *slot;
+    nextUse = (int*)malloc(totalAccess*sizeof(int));
+    if (!nextUse) {
+        exit(1);
+    }
+
+    int i;
+    radix_init(&last, totalAccess);
+    for (i = totalAccess-1; i >= 0; i--) {
+        slot = radix_slot(&last, accessArray[i].index);
+        nextUse[i] = *slot;
+        *slot = i;
+    }
+    radix_free(&last);
+}
+
+// Mattson's stack algorithm: a single pass gives the fault count for every
+// frame count up to maxframes. LRU stack distances come from a Fenwick tree
+// over the times at which each page was last touched; OPT keeps the top
+// maxframes of the priority stack ordered by next use, which is exactly
+// what OPT would hold at each size.
+void stack_distance(int maxframes) {
+    struct radixStruct last;
+    struct radixStruct stackPos;
+    int *tree = (int*)calloc(totalAccess+1, sizeof(int));
+    unsigned long long *stack = (unsigned long long*)malloc(maxframes*sizeof(unsigned long long));
+    int *stackNext = (int*)malloc(maxframes*sizeof(int));
+    int *lruHits = (int*)calloc(maxframes+1, sizeof(int));
+    int *optHits = (int*)calloc(maxframes+1, sizeof(int));
+    if (!tree || !stack || !stackNext || !lruHits || !optHits) {
+        exit(1);
+    }
+
+    int i, k, d, limit, yNext, t;
+    int *slot;
+    unsigned long long page, y, u;
+    int depth = 0;
+    radix_init(&last, -1);
+    radix_init(&stackPos, -1);
+
+    for (i = 0; i < totalAccess; i++) {
+        page = accessArray[i].index;
+
+        slot = radix_slot(&last, page);
+        if (*slot >= 0) {
+            d = fenwick_sum(tree, i)-fenwick_sum(tree, *slot+1)+1;
+            if (d <= maxframes) {
+                lruHits[d]++;
+            }
+            fenwick_add(tree, *slot, -1);
+        }
+        fenwick_add(tree, i, 1);
+        *slot = i;
+
+        d = radix_get(&stackPos, page);
+        if (d >= 0) {
+            optHits[d+1]++;
+        }
+        if (d == 0) {
+            stackNext[0] = nextUse[i];
+            continue;
+        }
+        limit = d > 0 ? d : depth;
+        if (limit == 0) {
+            stack[0] = page;
+            stackNext[0] = nextUse[i];
+            radix_set(&stackPos, page, 0);
+            depth = 1;
+            continue;
+        }
+        y = stack[0];
+        yNext = stackNext[0];
+        stack[0] = page;
+        stackNext[0] = nextUse[i];
+        radix_set(&stackPos, page, 0);
+        for (k = 1; k < limit; k++) {
+            if (stackNext[k] > yNext) {
+                u = stack[k];
+                stack[k] = y;
+                radix_set(&stackPos, y, k);
+                y = u;
+                t = stackNext[k];
+                stackNext[k] = yNext;
+                yNext = t;
+            }
+        }
+        if (limit < maxframes) {
+            stack[limit] = y;
+            stackNext[limit] = yNext;
+            radix_set(&stackPos, y, limit);
+            if (limit == depth) {
+                depth++;
+            }
+        }
+        else {
+            radix_set(&stackPos, y, -1);
+        }
+    }
+
+    printf("stack\n");
+    printf("Total memory accesses:\t%d\n", totalAccess);
+    printf("Frames\tLRU faults\tOPT faults\n");
+    int lruFaults = totalAccess;
+    int optFaults = totalAccess;
+    for (i = 1; i <= maxframes; i++) {
+        lruFaults -= lruHits[i];
+        optFaults -= optHits[i];
+        printf("%d\t%d\t%d\n", i, lruFaults, optFaults);
+    }
+
+    radix_free(&last);
+    radix_free(&stackPos);
+    free(tree);
+    free(stack);
+    free(stackNext);
+    free(lruHits);
+    free(optHits);
+}
+
+// Fenwick tree over reference times: the sum of entries before pos.
+int fenwick_sum(int *tree, int pos) {
+    int sum = 0;
+    for (; pos > 0; pos -= pos & -pos) {
+        sum += tree[pos];
+    }
+    return sum;
+}
+
+void fenwick_add(int *tree, int pos, int val) {
+    for (pos++; pos <= totalAccess; pos += pos & -pos) {
+        tree[pos] += val;
+    }
+}
+
+void init_frame(struct simStruct *sim) {
+    sim->framePage = (unsigned long long*)malloc(sim->numframes*sizeof(unsigned long long));
+    sim->frameFlags = (unsigned char*)calloc(sim->numframes, sizeof(unsigned char));
+    sim->frameTime = (unsigned int*)calloc(sim->numframes, sizeof(unsigned int));
+    sim->freeFrames = (int*)malloc(sim->numframes*sizeof(int));
+    if (!sim->framePage || !sim->frameFlags || !sim->frameTime || !sim->freeFrames) {
+        exit(1);
+    }
+
+    // Frames are handed out lowest first, as the old scan for an invalid
+    // frame did.
+    int i, k;
+    struct cacheStruct *c;
+    for (i = 0; i < sim->numframes; i++) {
+        sim->freeFrames[i] = sim->numframes-1-i;
+    }
+    sim->numFree = sim->numframes;
+    sim->resident = 0;
+
+    radix_init(&sim->pageTable, -1);
+    radix_init(&sim->regionResident, 0);
+    radix_init(&sim->regionHuge, 0);
+    // Processes count toward local shares once the simulation reaches
+    // their first reference, however much of the trace is loaded.
+    memset(sim->procResident, 0, sizeof(sim->procResident));
+    memset(sim->procFaults, 0, sizeof(sim->procFaults));
+    sim->procCount = 0;
+
+    if (sim->tlbEntries) {
+        sim->tlbTag = (unsigned long long*)malloc(sim->tlbEntries*sizeof(unsigned long long));
+        sim->tlbStamp = (unsigned int*)calloc(sim->tlbEntries, sizeof(unsigned int));
+        if (!sim->tlbTag || !sim->tlbStamp) {
+            exit(1);
+        }
+        for (i = 0; i < sim->tlbEntries; i++) {
+            sim->tlbTag[i] = ~0ULL;
+        }
+        sim->tlbClock = 0;
+    }
+
+    for (k = 0; k < sim->cacheLevels; k++) {
+        c = &sim->cache[k];
+        c->tag = (unsigned long long*)malloc(c->sets*c->ways*sizeof(unsigned long long));
+        c->stamp = (unsigned int*)calloc(c->sets*c->ways, sizeof(unsigned int));
+        c->dirty = (unsigned char*)calloc(c->sets*c->ways, sizeof(unsigned char));
+        if (!c->tag || !c->stamp || !c->dirty) {
+            exit(1);
+        }
+        for (i = 0; i < c->sets*c->ways; i++) {
+            c->tag[i] = ~0ULL;
+        }
+        c->clock = 0;
+    }
+
+    if (sim->policy->init) {
+        sim->policy->init(sim);
+    }
+    if (sim->prefetch && sim->prefetch->init) {
+        sim->prefetch->init(sim);
+    }
+}
+
+void free_frame(struct simStruct *sim) {
+    int k;
+    free(sim->framePage);
+    free(sim->frameFlags);
+    free(sim->frameTime);
+    free(sim->listPrev);
+    free(sim->listNext);
+    free(sim->listId);
+    free(sim->ghostPage);
+    free(sim->ghostFree);
+    free(sim->stackPrev);
+    free(sim->stackNext);
+    free(sim->freeFrames);
+    radix_free(&sim->pageTable);
+    radix_free(&sim->regionResident);
+    radix_free(&sim->regionHuge);
+    free(sim->tlbTag);
+    free(sim->tlbStamp);
+    for (k = 0; k < sim->cacheLevels; k++) {
+        free(sim->cache[k].tag);
+        free(sim->cache[k].stamp);
+        free(sim->cache[k].dirty);
+        sim->cache[k].tag = NULL;
+        sim->cache[k].stamp = NULL;
+        sim->cache[k].dirty = NULL;
+    }
+    free(sim->heap);
+    free(sim->heapPos);
+    free(sim->age);
+    free(sim->markovTag);
+    free(sim->markovNext);
+    sim->age = NULL;
+    sim->markovTag = NULL;
+    sim->markovNext = NULL;
+    sim->framePage = NULL;
+    sim->frameFlags = NULL;
+    sim->frameTime = NULL;
+    sim->listPrev = NULL;
+    sim->listNext = NULL;
+    sim->listId = NULL;
+    sim->ghostPage = NULL;
+    sim->ghostFree = NULL;
+    sim->stackPrev = NULL;
+    sim->stackNext = NULL;
+    sim->freeFrames = NULL;
+    sim->tlbTag = NULL;
+    sim->tlbStamp = NULL;
+    sim->heap = NULL;
+    sim->heapPos = NULL;
+}
+
+void set_frame(struct simStruct *sim, int j, unsigned long long index) {
+    if (sim->frameFlags[j] & VALID) {
+        radix_set(&sim->pageTable, sim->framePage[j], -1);
+        if (sim->tlbEntries) {
+            tlb_flush(sim, sim->framePage[j]);
+        }
+        if (sim->cacheLevels) {
+            cache_flush(sim, j);
+        }
+        sim->procResident[sim->framePage[j] >> PROCSHIFT]--;
+        if (sim->hugeThreshold) {
+            huge_remove(sim, sim->framePage[j]);
+        }
+        if (sim->frameFlags[j] & PREFETCHED) {
+            sim->wastedPrefetches++;
+        }
+    }
+    sim->frameFlags[j] = (sim->frameFlags[j] & ~PREFETCHED) | VALID;
+    sim->framePage[j] = index;
+    radix_set(&sim->pageTable, index, j);
+    sim->procResident[index >> PROCSHIFT]++;
+    if (sim->hugeThreshold) {
+        huge_add(sim, index);
+    }
+}
+
+// Mixed page sizes, as with transparent huge pages: once a fault leaves
+// hugeThreshold base pages of a 2 MiB region resident, huge_collapse()
+// loads the rest of the region, as khugepaged does, and promotes it. A
+// huge page so holds a frame for every base page it covers, and no page
+// of it can miss until an eviction splits it again, as reclaim does. The
+// filled-in pages are loaded like prefetches, without faults. Regions
+// bigger than memory are never promoted.
+void huge_add(struct simStruct *sim, unsigned long long index) {
+    (*radix_slot(&sim->regionResident, index >> REGIONSHIFT))++;
+}
+
+void huge_remove(struct simStruct *sim, unsigned long long index) {
+    int *count = radix_slot(&sim->regionResident, index >> REGIONSHIFT);
+    int *huge = radix_slot(&sim->regionHuge, index >> REGIONSHIFT);
+    if (*huge) {
+        *huge = 0;
+        sim->splits++;
+        sim->hugePages--;
+        sim->hugeCovered -= *count;
+        if (sim->tlbEntries) {
+            tlb_flush(sim, (index >> REGIONSHIFT) | HUGEKEY);
+        }
+    }
+    (*count)--;
+}
+
+void huge_collapse(struct simStruct *sim, int cur, unsigned long long index) {
+    unsigned long long region = index >> REGIONSHIFT;
+    unsigned long long page;
+    int count = radix_get(&sim->regionResident, region);
+    if (count < sim->hugeThreshold || radix_get(&sim->regionHuge, region)\
+            || sim->numframes < 1 << REGIONSHIFT) {
+        return;
+    }
+    sim->prefetching = 1;
+    for (page = region << REGIONSHIFT; page < (region+1) << REGIONSHIFT; page++) {
+        sim->hugeFills += load_page(sim, cur, page);
+    }
+    sim->prefetching = 0;
+    // Filling in can evict pages of the region itself when memory is
+    // tight, and then the collapse fails.
+    count = radix_get(&sim->regionResident, region);
+    if (count == 1 << REGIONSHIFT) {
+        radix_set(&sim->regionHuge, region, 1);
+        sim->promotions++;
+        sim->hugePages++;
+        sim->hugeCovered += count;
+    }
+}
+
+// Bytes mapped per TLB entry, with each huge page taking one entry and
+// every other resident page one of its own. Sampled on every reference,
+// as splits leave few huge pages by the end of a run.
+double huge_reach(struct simStruct *sim) {
+    int mappings = sim->resident-sim->hugeCovered+sim->hugePages;
+    return mappings ? ((double)(sim->resident-sim->hugeCovered)*(1 << pageBits)\
+        +(double)sim->hugePages*(1 << HUGEBITS))/mappings : 0;
+}
+
+// The TLB is tlbEntries/tlbWays sets of tlbWays entries, indexed by page
+// number modulo the number of sets. Page numbers carry the process, so
+// entries are tagged by address space as with ASIDs, and a huge page
+// takes one entry tagged with HUGEKEY. Empty entries have stamp 0, so
+// LRU and random replacement both fill them first. Evicting a page or
+// splitting a huge page shoots its entry down.
+unsigned long long tlb_key(struct simStruct *sim, unsigned long long index) {
+    if (sim->hugeThreshold && radix_get(&sim->regionHuge, index >> REGIONSHIFT)) {
+        return (index >> REGIONSHIFT) | HUGEKEY;
+    }
+    return index;
+}
+
+void tlb_access(struct simStruct *sim, unsigned long long index) {
+    unsigned long long key = tlb_key(sim, index);
+    int set = key%(sim->tlbEntries/sim->tlbWays)*sim->tlbWays;
+    unsigned long long *tag = sim->tlbTag+set;
+    unsigned int *stamp = sim->tlbStamp+set;
+    int w, v = 0;
+    sim->tlbClock++;
+    for (w = 0; w < sim->tlbWays; w++) {
+        if (tag[w] == key) {
+            stamp[w] = sim->tlbClock;
+            sim->tlbHits++;
+            return;
+        }
+        if (stamp[w] < stamp[v]) {
+            v = w;
+        }
+    }
+    sim->tlbWalks++;
+    if (sim->tlbRandom && stamp[v]) {
+        v = rand_r(&sim->tlbSeed)%sim->tlbWays;
+    }
+    tag[v] = key;
+    stamp[v] = sim->tlbClock;
+}
+
+void tlb_flush(struct simStruct *sim, unsigned long long key) {
+    int set = key%(sim->tlbEntries/sim->tlbWays)*sim->tlbWays;
+    int w;
+    for (w = 0; w < sim->tlbWays; w++) {
+        if (sim->tlbTag[set+w] == key) {
+            sim->tlbTag[set+w] = ~0ULL;
+            sim->tlbStamp[set+w] = 0;
+        }
+    }
+}
+
+// The caches are physically addressed, by frame j that holds the
+// reference's page and the offset within it, so pages of different
+// processes never share lines. access_page() makes the access once the
+// page is in, before any huge-page collapse or prefetch can evict it
+// again. Binary traces keep no offsets and touch only the first line of
+// each page.
+void cache_access(struct simStruct *sim, int j, unsigned int offset, unsigned char mode) {
+    cache_ref(sim, 0, (unsigned long long)j << (pageBits-LINEBITS) | offset >> LINEBITS, mode == 'W', 1);
+}
+
+// Look line up in level k, going on to level k+1 or memory past the last
+// level on a miss. Write-back caches allocate on a write and pass dirty
+// victims down a level; write-through caches pass every write down and
+// allocate only on reads. Those passed-down writes have demand 0 and are
+// left out of the level's access and miss counts.
+void cache_ref(struct simStruct *sim, int k, unsigned long long line, int write, int demand) {
+    struct cacheStruct *c = &sim->cache[k];
+    unsigned long long *tag;
+    unsigned int *stamp;
+    int set, w, v = 0;
+    if (k == sim->cacheLevels) {
+        if (write) {
+            sim->memWrites++;
+        }
+        else {
+            sim->memReads++;
+        }
+        return;
+    }
+
+    set = line%c->sets*c->ways;
+    tag = c->tag+set;
+    stamp = c->stamp+set;
+    c->clock++;
+    c->accesses += demand;
+    for (w = 0; w < c->ways; w++) {
+        if (tag[w] == line) {
+            stamp[w] = c->clock;
+            if (write && sim->writeThrough) {
+                cache_ref(sim, k+1, line, 1, 0);
+            }
+            else if (write) {
+                c->dirty[set+w] = 1;
+            }
+            return;
+        }
+        if (stamp[w] < stamp[v]) {
+            v = w;
+        }
+    }
+
+    c->misses += demand;
+    if (write && sim->writeThrough) {
+        cache_ref(sim, k+1, line, 1, 0);
+        return;
+    }
+    // A written-back victim replaces the whole line, so only demand
+    // misses read it from below.
+    if (demand) {
+        cache_ref(sim, k+1, line, 0, 1);
+    }
+    if (c->dirty[set+v]) {
+        cache_ref(sim, k+1, tag[v], 1, 0);
+    }
+    tag[v] = line;
+    stamp[v] = c->clock;
+    c->dirty[set+v] = write;
+}
+
+// Frame j is about to hold another page. Its dirty lines go back to memory
+// before the page is written out, once however many levels hold them, and
+// every line of the frame is dropped.
+void cache_flush(struct simStruct *sim, int j) {
+    unsigned long long line = (unsigned long long)j << (pageBits-LINEBITS);
+    unsigned long long end = line+(1ULL << (pageBits-LINEBITS));
+    struct cacheStruct *c;
+    int k, w, set, dirty;
+    for (; line < end; line++) {
+        dirty = 0;
+        for (k = 0; k < sim->cacheLevels; k++) {
+            c = &sim->cache[k];
+            set = line%c->sets*c->ways;
+            for (w = set; w < set+c->ways; w++) {
+                if (c->tag[w] == line) {
+                    dirty |= c->dirty[w];
+                    c->tag[w] = ~0ULL;
+                    c->stamp[w] = 0;
+                    c->dirty[w] = 0;
+                }
+            }
+        }
+        sim->memWrites += dirty;
+    }
+}
+
+// Replace the page in frame j, writing it out first if it is dirty.
+void evict_frame(struct simStruct *sim, int j, unsigned long long index, unsigned char mode) {
+    set_frame(sim, j, index);
+    if (sim->frameFlags[j] & DIRTY) {
+        sim->writes++;
+        sim->victimDirty = 1;
+        if (sim->diskLatency) {
+            disk_io(sim, !sim->prefetching);
+        }
+    }
+    if (mode == 'R') {
+        sim->frameFlags[j] &= ~DIRTY;
+    }
+    else if (mode == 'W') {
+        sim->frameFlags[j] |= DIRTY;
+    }
+}
+
+void access_frame(struct simStruct *sim) {
+    int i;
+    for (i = 0; i < totalAccess; i++) {
+        access_page(sim, i, accessArray[i].index, accessArray[i].offset, accessArray[i].mode);
+    }
+    if (sim->window && totalAccess) {
+        timeline_add(sim, totalAccess);
+    }
+}
+
+void access_page(struct simStruct *sim, int cur, unsigned long long index, unsigned int offset, unsigned char mode) {
+    struct policyStruct *policy = sim->policy;
+    int j;
+    long long start;
+
+    if (sim->window && cur && cur%sim->window == 0) {
+        timeline_add(sim, cur);
+    }
+    // Process slots are numbered in order of first reference.
+    if ((int)(index >> PROCSHIFT) >= sim->procCount) {
+        sim->procCount = (index >> PROCSHIFT)+1;
+    }
+    if (sim->diskLatency) {
+        flush_tick(sim, cur);
+    }
+    if (sim->hugeThreshold && sim->resident) {
+        sim->reachSum += huge_reach(sim);
+        sim->reachSamples++;
+    }
+    if (sim->tlbEntries) {
+        tlb_access(sim, index);
+    }
+    if (policy->tick) {
+        policy->tick(sim, cur);
+    }
+
+    j = policy->lookup(sim, index);
+    if (j != -1) {
+        sim->hits++;
+        //printf("%x\t Hit\n", index);
+        if (mode == 'W') {
+            sim->frameFlags[j] |= DIRTY;
+        }
+        policy->hit(sim, cur, j);
+        if (sim->cacheLevels) {
+            cache_access(sim, j, offset, mode);
+        }
+        if (sim->frameFlags[j] & PREFETCHED) {
+            sim->frameFlags[j] &= ~PREFETCHED;
+            sim->usefulPrefetches++;
+            prefetch_run(sim, cur, index);
+        }
+        return;
+    }
+
+    sim->faults++;
+    sim->procFaults[index >> PROCSHIFT]++;
+    start = sim->simTime;
+    sim->victimDirty = 0;
+    if (sim->numFree > 0) {
+        j = sim->freeFrames[--sim->numFree];
+        sim->resident++;
+        set_frame(sim, j, index);
+        if (mode == 'W') {
+            sim->frameFlags[j] |= DIRTY;
+        }
+        policy->fill(sim, cur, j);
+    }
+    else {
+        //printf("%x\t Miss\n", index);
+        policy->fault(sim, cur, index, mode);
+    }
+    // A fault waits for its victim to be written out, if dirty, and then
+    // for its own page to be read in.
+    if (sim->diskLatency) {
+        disk_io(sim, 1);
+        sim->serviceTime += sim->simTime-start;
+    }
+    if (sim->victimDirty) {
+        sim->dirtyFaults++;
+    }
+    if (sim->cacheLevels) {
+        cache_access(sim, radix_get(&sim->pageTable, index), offset, mode);
+    }
+    if (sim->hugeThreshold) {
+        huge_collapse(sim, cur, index);
+    }
+    if (sim->prefetch) {
+        prefetch_run(sim, cur, index);
+    }
+}
+
+void prefetch_run(struct simStruct *sim, int cur, unsigned long long index) {
+    if (sim->prefetch) {
+        sim->prefetching = 1;
+        sim->prefetch->predict(sim, cur, index);
+        sim->prefetching = 0;
+    }
+}
+
+// Prefetch page, skipping guesses that run past the end of index's
+// process. In a small memory the victim can be the very page that
+// triggered the prefetch, as when readahead thrashes.
+void prefetch_page(struct simStruct *sim, int cur, unsigned long long index, unsigned long long page) {
+    if (page >> PROCSHIFT == index >> PROCSHIFT && load_page(sim, cur, page)) {
+        sim->prefetches++;
+        sim->frameFlags[radix_get(&sim->pageTable, page)] |= PREFETCHED;
+    }
+}
+
+// Load page as if it had faulted, into a free frame or the policy's
+// victim, without counting a fault, unless it is already resident. The
+// read, and any write-out of the victim, go to the disk in the
+// background. Returns whether the page was loaded.
+int load_page(struct simStruct *sim, int cur, unsigned long long page) {
+    int j;
+    if (sim->policy->lookup(sim, page) != -1) {
+        return 0;
+    }
+    if (sim->numFree > 0) {
+        j = sim->freeFrames[--sim->numFree];
+        sim->resident++;
+        set_frame(sim, j, page);
+        sim->policy->fill(sim, cur, j);
+    }
+    else {
+        sim->policy->fault(sim, cur, page, 'R');
+    }
+    if (sim->diskLatency) {
+        disk_io(sim, 0);
+    }
+    return 1;
+}
+
+// Sequential readahead, sized from context as Linux does: the run of
+// resident pages just below the trigger shows how long its stream has
+// been sequential, and the window is twice that run, up to
+// prefetchDegree. Interleaved streams each keep their own window, and a
+// trigger with nothing resident below it reads nothing extra.
+void seq_predict(struct simStruct *sim, int cur, unsigned long long index) {
+    int run = 0;
+    int k;
+    while (run < sim->prefetchDegree && (index & ((1ULL << PROCSHIFT)-1)) > (unsigned long long)run\
+            && sim->policy->lookup(sim, index-run-1) != -1) {
+        run++;
+    }
+    for (k = 1; k <= 2*run && k <= sim->prefetchDegree; k++) {
+        prefetch_page(sim, cur, index, index+k);
+    }
+}
+
+// Stride detection: once two triggers in a row are the same nonzero
+// distance apart, load the next prefetchDegree pages along that stride.
+void stride_predict(struct simStruct *sim, int cur, unsigned long long index) {
+    long long delta = index-sim->strideLast;
+    int k;
+    if (delta && delta == sim->strideDelta) {
+        for (k = 1; k <= sim->prefetchDegree; k++) {
+            prefetch_page(sim, cur, index, index+k*delta);
+        }
+    }
+    sim->strideDelta = delta;
+    sim->strideLast = index;
+}
+
+// Markov prediction: a table of 1 << MARKOVBITS entries, hashed by page,
+// remembers the trigger that last followed each page. A trigger loads its
+// remembered successor, that page's successor, and so on for up to
+// prefetchDegree pages. Colliding pages overwrite each other.
+void init_markov(struct simStruct *sim) {
+    int i;
+    sim->markovTag = (unsigned long long*)malloc((1 << MARKOVBITS)*sizeof(unsigned long long));
+    sim->markovNext = (unsigned long long*)malloc((1 << MARKOVBITS)*sizeof(unsigned long long));
+    if (!sim->markovTag || !sim->markovNext) {
+        exit(1);
+    }
+    for (i = 0; i < 1 << MARKOVBITS; i++) {
+        sim->markovTag[i] = ~0ULL;
+    }
+    sim->markovLast = ~0ULL;
+}
+
+void markov_predict(struct simStruct *sim, int cur, unsigned long long index) {
+    unsigned long long page = index;
+    int h, k;
+    if (sim->markovLast != ~0ULL) {
+        h = sim->markovLast*0x9e3779b97f4a7c15ULL >> (64-MARKOVBITS);
+        sim->markovTag[h] = sim->markovLast;
+        sim->markovNext[h] = index;
+    }
+    sim->markovLast = index;
+    for (k = 0; k < sim->prefetchDegree; k++) {
+        h = page*0x9e3779b97f4a7c15ULL >> (64-MARKOVBITS);
+        if (sim->markovTag[h] != page || sim->markovNext[h] == index) {
+            break;
+        }
+        page = sim->markovNext[h];
+        prefetch_page(sim, cur, index, page);
+    }
+}
+
+// The disk model charges hitNs for every reference and serves one page
+// transfer at a time, each taking diskLatency. A fault's transfers go
+// ahead of queued background writes, as reads do under a deadline
+// scheduler, so the fault stalls only for a write already under way.
+// Background writes start whenever the disk would otherwise be idle.
+void disk_io(struct simStruct *sim, int wait) {
+    disk_idle(sim);
+    if (!wait) {
+        if (!sim->diskQueue && sim->diskFree < sim->simTime) {
+            sim->diskFree = sim->simTime;
+        }
+        sim->diskQueue++;
+        return;
+    }
+    if (sim->diskFree < sim->simTime) {
+        sim->diskFree = sim->simTime;
+    }
+    sim->diskFree += sim->diskLatency;
+    sim->simTime = sim->diskFree;
+}
+
+void disk_idle(struct simStruct *sim) {
+    while (sim->diskQueue && sim->diskFree < sim->simTime) {
+        sim->diskFree += sim->diskLatency;
+        sim->diskQueue--;
+    }
+}
+
+// The background cleaner wakes every flushInterval references and writes
+// out up to flushBatch dirty pages, sweeping the frames from where it last
+// stopped, so that fewer victims have to be written before reuse.
+void flush_tick(struct simStruct *sim, int cur) {
+    int n, j;
+    int batch = 0;
+    sim->simTime += sim->hitNs;
+    disk_idle(sim);
+    if (!sim->flushInterval || cur%sim->flushInterval) {
+        return;
+    }
+    for (n = 0; n < sim->numframes && batch < sim->flushBatch; n++) {
+        j = sim->flushHand;
+        sim->flushHand = (j+1)%sim->numframes;
+        if ((sim->frameFlags[j] & (VALID | DIRTY | REFERENCED)) == (VALID | DIRTY)) {
+            sim->frameFlags[j] &= ~DIRTY;
+            sim->writes++;
+            sim->cleaned++;
+            disk_io(sim, 0);
+            batch++;
+        }
+    }
+}
+
+int lookup_page(struct simStruct *sim, unsigned long long index) {
+    return radix_get(&sim->pageTable, index);
+}
+
+void radix_init(struct radixStruct *tree, int empty) {
+    tree->root = NULL;
+    tree->height = 0;
+    tree->empty = empty;
+    tree->lastLeaf = NULL;
+}
+
+// Return the leaf holding key, or NULL if there is none and create is 0.
+int *radix_leaf(struct radixStruct *tree, unsigned long long key, int create) {
+    void **slot, **node;
+    int h, i;
+    if (tree->lastLeaf && key >> LEAFBITS == tree->lastKey) {
+        return tree->lastLeaf;
+    }
+    while (key >> (LEAFBITS+NODEBITS*tree->height)) {
+        if (!create) {
+            return NULL;
+        }
+        if (tree->root) {
+            node = (void**)calloc(1 << NODEBITS, sizeof(void*));
+            if (!node) {
+                exit(1);
+            }
+            node[0] = tree->root;
+            tree->root = node;
+        }
+        tree->height++;
+    }
+
+    slot = &tree->root;
+    for (h = tree->height; h > 0; h--) {
+        if (!*slot) {
+            if (!create) {
+                return NULL;
+            }
+            *slot = calloc(1 << NODEBITS, sizeof(void*));
+            if (!*slot) {
+                exit(1);
+            }
+        }
+        slot = &((void**)*slot)[(key >> (LEAFBITS+NODEBITS*(h-1))) & ((1 << NODEBITS)-1)];
+    }
+    if (!*slot) {
+        if (!create) {
+            return NULL;
+        }
+        *slot = malloc((1 << LEAFBITS)*sizeof(int));
+        if (!*slot) {
+            exit(1);
+        }
+        for (i = 0; i < 1 << LEAFBITS; i++) {
+            ((int*)*slot)[i] = tree->empty;
+        }
+    }
+    tree->lastKey = key >> LEAFBITS;
+    tree->lastLeaf = (int*)*slot;
+    return tree->lastLeaf;
+}
+
+int radix_get(struct radixStruct *tree, unsigned long long key) {
+    int *leaf = radix_leaf(tree, key, 0);
+    return leaf ? leaf[key & ((1 << LEAFBITS)-1)] : tree->empty;
+}
+
+int *radix_slot(struct radixStruct *tree, unsigned long long key) {
+    return &radix_leaf(tree, key, 1)[key & ((1 << LEAFBITS)-1)];
+}
+
+void radix_set(struct radixStruct *tree, unsigned long long key, int value) {
+    *radix_slot(tree, key) = value;
+}
+
+void radix_free_node(void *node, int height) {
+    int i;
+    if (node && height > 0) {
+        for (i = 0; i < 1 << NODEBITS; i++) {
+            radix_free_node(((void**)node)[i], height-1);
+        }
+    }
+    free(node);
+}
+
+void radix_free(struct radixStruct *tree) {
+    radix_free_node(tree->root, tree->height);
+    radix_init(tree, tree->empty);
+}
+
+void heap_swap(struct simStruct *sim, int a, int b) {
+    int t = sim->heap[a];
+    sim->heap[a] = sim->heap[b];
+    sim->heap[b] = t;
+    sim->heapPos[sim->heap[a]] = a;
+    sim->heapPos[sim->heap[b]] = b;
+}
+
+void heap_up(struct simStruct *sim, int i) {
+    while (i > 0 && sim->policy->before(sim, sim->heap[i], sim->heap[(i-1)/2])) {
+        heap_swap(sim, i, (i-1)/2);
+        i = (i-1)/2;
+    }
+}
+
+void heap_down(struct simStruct *sim, int i) {
+    int c;
+    while ((c = 2*i+1) < sim->heapSize) {
+        if (c+1 < sim->heapSize && sim->policy->before(sim, sim->heap[c+1], sim->heap[c])) {
+            c++;
+        }
+        if (!sim->policy->before(sim, sim->heap[c], sim->heap[i])) {
+            break;
+        }
+        heap_swap(sim, i, c);
+        i = c;
+    }
+}
+
+void heap_push(struct simStruct *sim, int j) {
+    sim->heap[sim->heapSize] = j;
+    sim->heapPos[j] = sim->heapSize;
+    sim->heapSize++;
+    heap_up(sim, sim->heapSize-1);
+}
+
+void heap_update(struct simStruct *sim, int j) {
+    heap_up(sim, sim->heapPos[j]);
+    heap_down(sim, sim->heapPos[j]);
+}
+
+void init_heap(struct simStruct *sim) {
+    sim->heap = (int*)malloc(sim->numframes*sizeof(int));
+    sim->heapPos = (int*)malloc(sim->numframes*sizeof(int));
+    if (!sim->heap || !sim->heapPos) {
+        exit(1);
+    }
+}
+
+// OPT evicts the latest next use, ties going to the lower frame like the
+// old linear scan.
+int opt_before(struct simStruct *sim, int a, int b) {
+    if (sim->frameTime[a] != sim->frameTime[b]) {
+        return sim->frameTime[a] > sim->frameTime[b];
+    }
+    return a < b;
+}
+
+void opt_hit(struct simStruct *sim, int cur, int j) {
+    sim->frameTime[j] = nextUse[cur];
+    heap_update(sim, j);
+}
+
+void opt_fill(struct simStruct *sim, int cur, int j) {
+    sim->frameTime[j] = nextUse[cur];
+    heap_push(sim, j);
+}
+
+void my_opt(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j = sim->heap[0];
+    evict_frame(sim, j, index, mode);
+    sim->frameTime[j] = nextUse[cur];
+    heap_update(sim, j);
+}
+
+void clock_hit(struct simStruct *sim, int cur, int j) {
+    sim->frameFlags[j] |= REFERENCED;
+}
+
+void my_clock(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int i = sim->clocks;
+    int p = index >> PROCSHIFT;
+    int under = sim->local && local_under(sim, p);
+    while (1) {
+        if (!sim->local || local_victim(sim, i, p, under)) {
+            if (!(sim->frameFlags[i] & REFERENCED)) {
+                evict_frame(sim, i, index, mode);
+                sim->frameFlags[i] |= REFERENCED;
+                break;
+            }
+            sim->frameFlags[i] &= ~REFERENCED;
+        }
+        i = (i+1)%sim->numframes;
+    }
+    sim->clocks = (i+1)%sim->numframes;
+}
+
+// Aging counters live in their own array of ageWidth-bit entries rather
+// than in the frame table, so the periodic shift and the victim search stream
+// through packed memory a vector at a time. The array is padded to whole
+// vectors with all-ones counters, which never win the minimum.
+void init_aging(struct simStruct *sim) {
+    int bytes = sim->numframes*(sim->ageWidth/8);
+    sim->ageVecs = (bytes+AGEVEC-1)/AGEVEC;
+    sim->age = aligned_alloc(AGEVEC, sim->ageVecs*AGEVEC);
+    if (!sim->age) {
+        exit(1);
+    }
+    memset(sim->age, 0, bytes);
+    memset((char*)sim->age+bytes, 0xff, sim->ageVecs*AGEVEC-bytes);
+}
+
+unsigned long long age_get(struct simStruct *sim, int j) {
+    switch (sim->ageWidth) {
+        case 8:
+            return ((unsigned char*)sim->age)[j];
+        case 16:
+            return ((unsigned short*)sim->age)[j];
+        case 32:
+            return ((unsigned int*)sim->age)[j];
+        default:
+            return ((unsigned long long*)sim->age)[j];
+    }
+}
+
+void age_set(struct simStruct *sim, int j, unsigned long long value) {
+    switch (sim->ageWidth) {
+        case 8:
+            ((unsigned char*)sim->age)[j] = value;
+            break;
+        case 16:
+            ((unsigned short*)sim->age)[j] = value;
+            break;
+        case 32:
+            ((unsigned int*)sim->age)[j] = value;
+            break;
+        default:
+            ((unsigned long long*)sim->age)[j] = value;
+            break;
+    }
+}
+
+void age_shift(struct simStruct *sim) {
+    int bytes = sim->numframes*(sim->ageWidth/8);
+    int i;
+    switch (sim->ageWidth) {
+        case 8:
+            for (i = 0; i < sim->ageVecs; i++) {
+                ((ageVec8*)sim->age)[i] >>= 1;
+            }
+            break;
+        case 16:
+            for (i = 0; i < sim->ageVecs; i++) {
+                ((ageVec16*)sim->age)[i] >>= 1;
+            }
+            break;
+        case 32:
+            for (i = 0; i < sim->ageVecs; i++) {
+                ((ageVec32*)sim->age)[i] >>= 1;
+            }
+            break;
+        default:
+            for (i = 0; i < sim->ageVecs; i++) {
+                ((ageVec64*)sim->age)[i] >>= 1;
+            }
+            break;
+    }
+    memset((char*)sim->age+bytes, 0xff, sim->ageVecs*AGEVEC-bytes);
+}
+
+// Return the first frame holding the smallest counter: a vector minimum
+// over the whole array, then a vector search for the first lane equal to
+// it. This keeps the old linear scan's choice of the lowest frame on ties.
+int age_min(struct simStruct *sim) {
+    int per = AGEVEC/(sim->ageWidth/8);
+    unsigned long long min = ~0ULL;
+    int i, k;
+    ageVec64 hit;
+    switch (sim->ageWidth) {
+        case 8: {
+            ageVec8 *v = (ageVec8*)sim->age;
+            ageVec8 m = v[0];
+            for (i = 1; i < sim->ageVecs; i++) {
+                m = (ageVec8)((v[i] < m) & (v[i]^m))^m;
+            }
+            for (k = 0; k < per; k++) {
+                min = m[k] < min ? m[k] : min;
+            }
+            for (i = 0; i < sim->ageVecs; i++) {
+                hit = (ageVec64)(v[i] == (unsigned char)min);
+                if (hit[0] | hit[1] | hit[2] | hit[3]) {
+                    break;
+                }
+            }
+            break;
+        }
+        case 16: {
+            ageVec16 *v = (ageVec16*)sim->age;
+            ageVec16 m = v[0];
+            for (i = 1; i < sim->ageVecs; i++) {
+                m = (ageVec16)((v[i] < m) & (v[i]^m))^m;
+            }
+            for (k = 0; k < per; k++) {
+                min = m[k] < min ? m[k] : min;
+            }
+            for (i = 0; i < sim->ageVecs; i++) {
+                hit = (ageVec64)(v[i] == (unsigned short)min);
+                if (hit[0] | hit[1] | hit[2] | hit[3]) {
+                    break;
+                }
+            }
+            break;
+        }
+        case 32: {
+            ageVec32 *v = (ageVec32*)sim->age;
+            ageVec32 m = v[0];
+            for (i = 1; i < sim->ageVecs; i++) {
+                m = (ageVec32)((v[i] < m) & (v[i]^m))^m;
+            }
+            for (k = 0; k < per; k++) {
+                min = m[k] < min ? m[k] : min;
+            }
+            for (i = 0; i < sim->ageVecs; i++) {
+                hit = (ageVec64)(v[i] == (unsigned int)min);
+                if (hit[0] | hit[1] | hit[2] | hit[3]) {
+                    break;
+                }
+            }
+            break;
+        }
+        default: {
+            ageVec64 *v = (ageVec64*)sim->age;
+            ageVec64 m = v[0];
+            for (i = 1; i < sim->ageVecs; i++) {
+                m = (ageVec64)((v[i] < m) & (v[i]^m))^m;
+            }
+            for (k = 0; k < per; k++) {
+                min = m[k] < min ? m[k] : min;
+            }
+            for (i = 0; i < sim->ageVecs; i++) {
+                hit = (ageVec64)(v[i] == min);
+                if (hit[0] | hit[1] | hit[2] | hit[3]) {
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    for (k = i*per; age_get(sim, k) != min; k++);
+    return k;
+}
+
+void aging_tick(struct simStruct *sim, int cur) {
+    if (cur%sim->refresh == 0) {
+        age_shift(sim);
+    }
+}
+
+void aging_hit(struct simStruct *sim, int cur, int j) {
+    age_set(sim, j, age_get(sim, j) | 1ULL << (sim->ageWidth-1));
+}
+
+void aging_fill(struct simStruct *sim, int cur, int j) {
+    age_set(sim, j, 1ULL << (sim->ageWidth-1));
+}
+
+void my_aging(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j = age_min(sim);
+    evict_frame(sim, j, index, mode);
+    age_set(sim, j, 1ULL << (sim->ageWidth-1));
+}
+
+void my_wsclock(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int i = sim->clocks;
+    int min = cur+1;
+    int p = index >> PROCSHIFT;
+    int under = sim->local && local_under(sim, p);
+    int j, k;
+    while (1) {
+        if (sim->local && !local_victim(sim, i, p, under)) {
+            // Another process's page under local replacement: leave it be.
+        }
+        else if (!(sim->frameFlags[i] & REFERENCED)) {
+            if (cur-sim->frameTime[i] > sim->tau) {
+                if (sim->frameFlags[i] & DIRTY) {
+                    sim->writes++;
+                    sim->frameFlags[i] &= ~DIRTY;
+                    if (sim->diskLatency) {
+                        disk_io(sim, 0);
+                    }
+                }
+                else {
+                    evict_frame(sim, i, index, mode);
+                    sim->frameFlags[i] |= REFERENCED;
+                    //sim->frameTime[i] = cur;
+                    break;
+                }
+            }
+        }
+        else {
+            sim->frameTime[i] = cur;
+            sim->frameFlags[i] &= ~REFERENCED;
+        }
+        i = (i+1)%sim->numframes;
+        if (i == sim->clocks) {
+            for (j = 0; j < sim->numframes; j++) {
+                if (sim->local && !local_victim(sim, (i+j)%sim->numframes, p, under)) {
+                    continue;
+                }
+                if (sim->frameTime[(i+j)%sim->numframes] < min) {
+                    min = sim->frameTime[(i+j)%sim->numframes];
+                    k = (i+j)%sim->numframes;
+                }
+            }
+            evict_frame(sim, k, index, mode);
+            sim->frameFlags[k] |= REFERENCED;
+            //sim->frameTime[k] = cur;
+            i--;
+            break;
+        }
+    }
+    sim->clocks = (i+1)%sim->numframes;
+}
+
+// List policies thread frames and ghost entries onto circular doubly
+// linked lists through listPrev and listNext. Nodes 0..numframes-1 are
+// frames, the next ghosts nodes remember evicted pages, and the last heads
+// nodes are the list heads, from listBase on. The page table already maps
+// a page to its frame in O(1), so moving a frame never needs a search, and
+// listNext of a head is always its oldest entry.
+void init_lists(struct simStruct *sim, int heads, int ghosts) {
+    int nodes = sim->numframes+ghosts+heads;
+    sim->listPrev = (int*)malloc(nodes*sizeof(int));
+    sim->listNext = (int*)malloc(nodes*sizeof(int));
+    sim->listId = (unsigned char*)malloc(nodes*sizeof(unsigned char));
+    if (!sim->listPrev || !sim->listNext || !sim->listId) {
+        exit(1);
+    }
+    if (ghosts) {
+        sim->ghostPage = (unsigned long long*)malloc(ghosts*sizeof(unsigned long long));
+        sim->ghostFree = (int*)malloc(ghosts*sizeof(int));
+        if (!sim->ghostPage || !sim->ghostFree) {
+            exit(1);
+        }
+    }
+
+    int i;
+    sim->listBase = sim->numframes+ghosts;
+    for (i = 0; i < heads; i++) {
+        sim->listPrev[sim->listBase+i] = sim->listBase+i;
+        sim->listNext[sim->listBase+i] = sim->listBase+i;
+        sim->listId[sim->listBase+i] = i;
+        sim->listLen[i] = 0;
+    }
+    for (i = 0; i < ghosts; i++) {
+        sim->ghostFree[i] = sim->listBase-1-i;
+    }
+    sim->numGhostFree = ghosts;
+}
+
+void init_list(struct simStruct *sim) {
+    init_lists(sim, 1, 0);
+}
+
+int list_first(struct simStruct *sim, int h) {
+    return sim->listNext[sim->listBase+h];
+}
+
+void list_remove(struct simStruct *sim, int j) {
+    sim->listNext[sim->listPrev[j]] = sim->listNext[j];
+    sim->listPrev[sim->listNext[j]] = sim->listPrev[j];
+    sim->listLen[sim->listId[j]]--;
+}
+
+// Link j in just before node at, on the same list.
+void list_insert(struct simStruct *sim, int at, int j) {
+    sim->listPrev[j] = sim->listPrev[at];
+    sim->listNext[j] = at;
+    sim->listNext[sim->listPrev[at]] = j;
+    sim->listPrev[at] = j;
+    sim->listId[j] = sim->listId[at];
+    sim->listLen[sim->listId[j]]++;
+}
+
+void list_append(struct simStruct *sim, int h, int j) {
+    list_insert(sim, sim->listBase+h, j);
+}
+
+void list_fill(struct simStruct *sim, int cur, int j) {
+    list_append(sim, 0, j);
+}
+
+void lru_hit(struct simStruct *sim, int cur, int j) {
+    list_remove(sim, j);
+    list_append(sim, 0, j);
+}
+
+void my_lru(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j = list_first(sim, 0);
+    evict_frame(sim, j, index, mode);
+    list_remove(sim, j);
+    list_append(sim, 0, j);
+}
+
+void fifo_hit(struct simStruct *sim, int cur, int j) {
+}
+
+void my_fifo(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    my_lru(sim, cur, index, mode);
+}
+
+// Each simulation has its own rand_r() state, seeded from -s, so sweeps
+// on several threads are repeatable.
+void my_random(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j = rand_r(&sim->seed)%sim->numframes;
+    evict_frame(sim, j, index, mode);
+}
+
+// NRU clears every R bit each refresh references.
+void nru_tick(struct simStruct *sim, int cur) {
+    int i;
+    if (sim->refresh > 0 && cur%sim->refresh == 0) {
+        for (i = 0; i < sim->numframes; i++) {
+            sim->frameFlags[i] &= ~REFERENCED;
+        }
+    }
+}
+
+// Evict from the lowest nonempty class of (referenced, dirty), scanning
+// from where the last search stopped so ties are spread over the frames.
+void my_nru(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int i = sim->clocks;
+    int best = 4;
+    int j = i;
+    int k, c;
+    for (k = 0; k < sim->numframes; k++) {
+        c = (sim->frameFlags[i] & REFERENCED ? 2 : 0) | (sim->frameFlags[i] & DIRTY ? 1 : 0);
+        if (c < best) {
+            best = c;
+            j = i;
+            if (c == 0) {
+                break;
+            }
+        }
+        i = (i+1)%sim->numframes;
+    }
+    evict_frame(sim, j, index, mode);
+    sim->frameFlags[j] |= REFERENCED;
+    sim->clocks = (j+1)%sim->numframes;
+}
+
+void second_fill(struct simStruct *sim, int cur, int j) {
+    sim->frameFlags[j] |= REFERENCED;
+    list_append(sim, 0, j);
+}
+
+// Second chance proper: take the oldest frame off the FIFO list, and if it
+// was referenced clear the bit and send it to the back instead of evicting.
+void my_second(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j;
+    while (1) {
+        j = list_first(sim, 0);
+        list_remove(sim, j);
+        list_append(sim, 0, j);
+        if (!(sim->frameFlags[j] & REFERENCED)) {
+            break;
+        }
+        sim->frameFlags[j] &= ~REFERENCED;
+    }
+    evict_frame(sim, j, index, mode);
+    sim->frameFlags[j] |= REFERENCED;
+}
+
+// Ghost entries stand for evicted pages a policy still remembers. Their
+// page table entry is -2-k for ghost node numframes+k, so ordinary lookups
+// see anything below 0 as a miss.
+int ghost_lookup(struct simStruct *sim, unsigned long long index) {
+    int j = radix_get(&sim->pageTable, index);
+    return j >= 0 ? j : -1;
+}
+
+int ghost_find(struct simStruct *sim, unsigned long long index) {
+    int j = radix_get(&sim->pageTable, index);
+    return j < -1 ? sim->numframes-2-j : -1;
+}
+
+// Turn the page in frame j into a ghost and return its node, which the
+// caller links onto a list. The frame is left unmapped for evict_frame().
+int ghost_new(struct simStruct *sim, int j) {
+    int g = sim->ghostFree[--sim->numGhostFree];
+    sim->ghostPage[g-sim->numframes] = sim->framePage[j];
+    radix_set(&sim->pageTable, sim->framePage[j], sim->numframes-2-g);
+    if (sim->tlbEntries) {
+        tlb_flush(sim, sim->framePage[j]);
+    }
+    if (sim->cacheLevels) {
+        cache_flush(sim, j);
+    }
+    if (sim->frameFlags[j] & PREFETCHED) {
+        sim->wastedPrefetches++;
+    }
+    sim->frameFlags[j] &= ~(VALID | PREFETCHED);
+    sim->procResident[sim->framePage[j] >> PROCSHIFT]--;
+    if (sim->hugeThreshold) {
+        huge_remove(sim, sim->framePage[j]);
+    }
+    return g;
+}
+
+void ghost_drop(struct simStruct *sim, int g) {
+    radix_set(&sim->pageTable, sim->ghostPage[g-sim->numframes], -1);
+    list_remove(sim, g);
+    sim->ghostFree[sim->numGhostFree++] = g;
+}
+
+// ARC and CAR keep resident pages seen once in T1 and more often in T2,
+// with ghosts of pages evicted from each in B1 and B2. A ghost hit moves
+// target, the size T1 aims for, toward the list that would have kept the
+// page. At most numframes ghosts are live, plus one while CAR replaces.
+void init_arc(struct simStruct *sim) {
+    init_lists(sim, 4, sim->numframes+1);
+    sim->target = 0;
+}
+
+void arc_hit(struct simStruct *sim, int cur, int j) {
+    list_remove(sim, j);
+    list_append(sim, T2, j);
+}
+
+void arc_fill(struct simStruct *sim, int cur, int j) {
+    list_append(sim, T1, j);
+}
+
+// Evict the LRU page of T1 or T2 into its ghost list and return its frame.
+int arc_replace(struct simStruct *sim, int inB2) {
+    int t1 = sim->listLen[T1];
+    int j;
+    if (t1 > 0 && (t1 > sim->target || (inB2 && t1 == sim->target) || sim->listLen[T2] == 0)) {
+        j = list_first(sim, T1);
+        list_remove(sim, j);
+        list_append(sim, B1, ghost_new(sim, j));
+    }
+    else {
+        j = list_first(sim, T2);
+        list_remove(sim, j);
+        list_append(sim, B2, ghost_new(sim, j));
+    }
+    return j;
+}
+
+void my_arc(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int c = sim->numframes;
+    int *len = sim->listLen;
+    int g = ghost_find(sim, index);
+    int j, d;
+    if (g >= 0 && sim->listId[g] == B1) {
+        d = len[B2]/len[B1];
+        sim->target += d > 1 ? d : 1;
+        if (sim->target > c) {
+            sim->target = c;
+        }
+        ghost_drop(sim, g);
+        j = arc_replace(sim, 0);
+    }
+    else if (g >= 0) {
+        d = len[B1]/len[B2];
+        sim->target -= d > 1 ? d : 1;
+        if (sim->target < 0) {
+            sim->target = 0;
+        }
+        ghost_drop(sim, g);
+        j = arc_replace(sim, 1);
+    }
+    else if (len[T1]+len[B1] == c && len[T1] == c) {
+        j = list_first(sim, T1);
+        list_remove(sim, j);
+    }
+    else {
+        if (len[T1]+len[B1] == c) {
+            ghost_drop(sim, list_first(sim, B1));
+        }
+        else if (len[T1]+len[T2]+len[B1]+len[B2] == 2*c) {
+            ghost_drop(sim, list_first(sim, B2));
+        }
+        j = arc_replace(sim, 0);
+    }
+    evict_frame(sim, j, index, mode);
+    list_append(sim, g >= 0 ? T2 : T1, j);
+}
+
+void car_fill(struct simStruct *sim, int cur, int j) {
+    sim->frameFlags[j] &= ~REFERENCED;
+    list_append(sim, T1, j);
+}
+
+// CAR runs T1 and T2 as clocks whose hand is the head of each list, so a
+// hit only sets the R bit. Referenced pages at the T1 hand move to T2.
+int car_replace(struct simStruct *sim) {
+    int j, h;
+    while (1) {
+        h = sim->listLen[T1] >= (sim->target > 1 ? sim->target : 1) ? T1 : T2;
+        j = list_first(sim, h);
+        list_remove(sim, j);
+        if (!(sim->frameFlags[j] & REFERENCED)) {
+            list_append(sim, h == T1 ? B1 : B2, ghost_new(sim, j));
+            return j;
+        }
+        sim->frameFlags[j] &= ~REFERENCED;
+        list_append(sim, T2, j);
+    }
+}
+
+void my_car(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int c = sim->numframes;
+    int *len = sim->listLen;
+    int g = ghost_find(sim, index);
+    int j = car_replace(sim);
+    int d;
+    if (g < 0) {
+        if (len[T1]+len[B1] == c && len[B1] > 0) {
+            ghost_drop(sim, list_first(sim, B1));
+        }
+        else if (len[T1]+len[T2]+len[B1]+len[B2] == 2*c && len[B2] > 0) {
+            ghost_drop(sim, list_first(sim, B2));
+        }
+    }
+    else if (sim->listId[g] == B1) {
+        d = len[B2]/len[B1];
+        sim->target += d > 1 ? d : 1;
+        if (sim->target > c) {
+            sim->target = c;
+        }
+        ghost_drop(sim, g);
+    }
+    else {
+        d = len[B1]/len[B2];
+        sim->target -= d > 1 ? d : 1;
+        if (sim->target < 0) {
+            sim->target = 0;
+        }
+        ghost_drop(sim, g);
+    }
+    evict_frame(sim, j, index, mode);
+    sim->frameFlags[j] &= ~REFERENCED;
+    list_append(sim, g >= 0 ? T2 : T1, j);
+}
+
+// CLOCK-Pro keeps hot pages, resident cold pages and ghosts of cold pages
+// still in their test period on one clock. New entries go in just behind
+// handHot. handCold evicts cold pages, promoting those referenced during
+// their test period; handHot demotes unreferenced hot pages; handTest ends
+// test periods once there are more ghosts than frames. target is the
+// number of frames cold pages aim for: a reuse inside a test period grows
+// it, a test period that runs out shrinks it.
+void init_clockpro(struct simStruct *sim) {
+    init_lists(sim, 1, sim->numframes+1);
+    sim->target = 1;
+    sim->hotPages = 0;
+    sim->handHot = sim->listBase;
+    sim->handCold = sim->listBase;
+    sim->handTest = sim->listBase;
+}
+
+// Take n off the clock, first moving any hand on it to the next entry.
+void clockpro_unlink(struct simStruct *sim, int n) {
+    if (sim->handHot == n) {
+        sim->handHot = sim->listNext[n];
+    }
+    if (sim->handCold == n) {
+        sim->handCold = sim->listNext[n];
+    }
+    if (sim->handTest == n) {
+        sim->handTest = sim->listNext[n];
+    }
+    if (n < sim->numframes) {
+        list_remove(sim, n);
+    }
+    else {
+        ghost_drop(sim, n);
+    }
+}
+
+void clockpro_head(struct simStruct *sim, int n) {
+    list_insert(sim, sim->handHot, n);
+}
+
+void clockpro_fill(struct simStruct *sim, int cur, int j) {
+    sim->frameFlags[j] = (sim->frameFlags[j] & ~(HOT | REFERENCED)) | TEST;
+    clockpro_head(sim, j);
+}
+
+// Run handCold until it frees a frame and return it. The frame is left
+// unmapped if its page became a ghost.
+int clockpro_cold(struct simStruct *sim) {
+    int n, g;
+    while (1) {
+        n = sim->handCold;
+        if (n >= sim->numframes || (sim->frameFlags[n] & HOT)) {
+            sim->handCold = sim->listNext[n];
+            continue;
+        }
+        if (sim->frameFlags[n] & REFERENCED) {
+            sim->frameFlags[n] &= ~REFERENCED;
+            clockpro_unlink(sim, n);
+            clockpro_head(sim, n);
+            if (sim->frameFlags[n] & TEST) {
+                sim->frameFlags[n] = (sim->frameFlags[n] & ~TEST) | HOT;
+                sim->hotPages++;
+                if (sim->target < sim->numframes) {
+                    sim->target++;
+                }
+                while (sim->hotPages > sim->numframes-sim->target) {
+                    clockpro_hot(sim);
+                }
+            }
+            else {
+                sim->frameFlags[n] |= TEST;
+            }
+            continue;
+        }
+        sim->handCold = sim->listNext[n];
+        if (sim->frameFlags[n] & TEST) {
+            g = ghost_new(sim, n);
+            list_insert(sim, n, g);
+            if (sim->handHot == n) {
+                sim->handHot = g;
+            }
+            if (sim->handTest == n) {
+                sim->handTest = g;
+            }
+            list_remove(sim, n);
+            sim->frameFlags[n] &= ~TEST;
+            if (sim->numGhostFree == 0) {
+                clockpro_test(sim);
+            }
+        }
+        else {
+            clockpro_unlink(sim, n);
+        }
+        return n;
+    }
+}
+
+// Advance handHot past one hot page that has not been referenced since
+// the last lap, demoting it to cold and ending test periods on the way.
+void clockpro_hot(struct simStruct *sim) {
+    int n;
+    while (1) {
+        n = sim->handHot;
+        sim->handHot = sim->listNext[n];
+        if (n >= sim->listBase) {
+            continue;
+        }
+        if (n < sim->numframes && (sim->frameFlags[n] & HOT)) {
+            if (sim->frameFlags[n] & REFERENCED) {
+                sim->frameFlags[n] &= ~REFERENCED;
+                continue;
+            }
+            sim->frameFlags[n] &= ~HOT;
+            sim->hotPages--;
+            return;
+        }
+        if (n >= sim->numframes || (sim->frameFlags[n] & TEST)) {
+            if (n >= sim->numframes) {
+                clockpro_unlink(sim, n);
+            }
+            else {
+                sim->frameFlags[n] &= ~TEST;
+            }
+            if (sim->target > 1) {
+                sim->target--;
+            }
+        }
+    }
+}
+
+// Advance handTest, ending test periods, until ghosts no longer outnumber
+// frames.
+void clockpro_test(struct simStruct *sim) {
+    int n;
+    while (sim->numGhostFree == 0) {
+        n = sim->handTest;
+        sim->handTest = sim->listNext[n];
+        if (n >= sim->listBase || (n < sim->numframes && !(sim->frameFlags[n] & TEST))) {
+            continue;
+        }
+        if (n >= sim->numframes) {
+            clockpro_unlink(sim, n);
+        }
+        else {
+            sim->frameFlags[n] &= ~TEST;
+        }
+        if (sim->target > 1) {
+            sim->target--;
+        }
+    }
+}
+
+void my_clockpro(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j = clockpro_cold(sim);
+    int g = ghost_find(sim, index);
+    if (g >= 0) {
+        clockpro_unlink(sim, g);
+        if (sim->target < sim->numframes) {
+            sim->target++;
+        }
+    }
+    evict_frame(sim, j, index, mode);
+    sim->frameFlags[j] &= ~(HOT | TEST | REFERENCED);
+    if (g >= 0) {
+        sim->frameFlags[j] |= HOT;
+        sim->hotPages++;
+        clockpro_head(sim, j);
+        while (sim->hotPages > sim->numframes-sim->target) {
+            clockpro_hot(sim);
+        }
+    }
+    else {
+        sim->frameFlags[j] |= TEST;
+        clockpro_head(sim, j);
+    }
+}
+
+// 2Q, full version: new pages enter A1in, a FIFO of a quarter of the
+// frames. Pages pushed out of A1in are remembered in A1out, a ghost FIFO
+// of half as many entries as frames, and only a fault on one of those
+// admits the page to Am, which is LRU.
+void init_2q(struct simStruct *sim) {
+    init_lists(sim, 3, sim->numframes/2+1);
+}
+
+void twoq_hit(struct simStruct *sim, int cur, int j) {
+    if (sim->listId[j] == AM) {
+        list_remove(sim, j);
+        list_append(sim, AM, j);
+    }
+}
+
+void twoq_fill(struct simStruct *sim, int cur, int j) {
+    list_append(sim, A1IN, j);
+}
+
+void my_2q(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int g = ghost_find(sim, index);
+    int j;
+    if (g >= 0) {
+        ghost_drop(sim, g);
+    }
+    if (sim->listLen[A1IN] > sim->numframes/4 || sim->listLen[AM] == 0) {
+        j = list_first(sim, A1IN);
+        list_remove(sim, j);
+        list_append(sim, A1OUT, ghost_new(sim, j));
+        if (sim->listLen[A1OUT] > sim->numframes/2) {
+            ghost_drop(sim, list_first(sim, A1OUT));
+        }
+    }
+    else {
+        j = list_first(sim, AM);
+        list_remove(sim, j);
+    }
+    evict_frame(sim, j, index, mode);
+    list_append(sim, g >= 0 ? AM : A1IN, j);
+}
+
+// LIRS keeps a recency stack S, threaded through stackPrev and stackNext,
+// holding LIR pages (marked HOT) and HIR pages that were touched more
+// recently than the oldest LIR page, resident or not. Resident HIR pages
+// also sit on the HIRS queue, from which victims come; 1% of the frames
+// (at least one) are set aside for them. A HIR page touched again while
+// still in S becomes LIR and the LIR page at the bottom of S is demoted.
+// Non-resident HIR pages are ghosts, queued on GHOSTS in the order they
+// were evicted; when there are more of them than frames the oldest is
+// dropped, which bounds S.
+void init_lirs(struct simStruct *sim) {
+    init_lists(sim, 2, sim->numframes+1);
+    sim->stackHead = sim->listBase+2;
+    sim->stackPrev = (int*)malloc((sim->stackHead+1)*sizeof(int));
+    sim->stackNext = (int*)malloc((sim->stackHead+1)*sizeof(int));
+    if (!sim->stackPrev || !sim->stackNext) {
+        exit(1);
+    }
+    sim->stackPrev[sim->stackHead] = sim->stackHead;
+    sim->stackNext[sim->stackHead] = sim->stackHead;
+    sim->hotPages = 0;
+}
+
+void stack_remove(struct simStruct *sim, int n) {
+    sim->stackNext[sim->stackPrev[n]] = sim->stackNext[n];
+    sim->stackPrev[sim->stackNext[n]] = sim->stackPrev[n];
+}
+
+// Link n into S just below at; at == stackHead puts it on top.
+void stack_insert(struct simStruct *sim, int at, int n) {
+    sim->stackPrev[n] = sim->stackPrev[at];
+    sim->stackNext[n] = at;
+    sim->stackNext[sim->stackPrev[at]] = n;
+    sim->stackPrev[at] = n;
+}
+
+// Pop HIR entries off the bottom of S until an LIR page is there.
+void lirs_prune(struct simStruct *sim) {
+    int n;
+    while ((n = sim->stackNext[sim->stackHead]) != sim->stackHead\
+            && (n >= sim->numframes || !(sim->frameFlags[n] & HOT))) {
+        stack_remove(sim, n);
+        if (n >= sim->numframes) {
+            ghost_drop(sim, n);
+        }
+        else {
+            sim->frameFlags[n] &= ~STACKED;
+        }
+    }
+}
+
+// Make frame j, already on top of S, an LIR page and demote the LIR page
+// at the bottom of S to the tail of the HIR queue. With a single frame
+// there are no other LIR pages and j is demoted straight back.
+void lirs_promote(struct simStruct *sim, int j) {
+    int b;
+    sim->frameFlags[j] |= HOT;
+    lirs_prune(sim);
+    b = sim->stackNext[sim->stackHead];
+    stack_remove(sim, b);
+    sim->frameFlags[b] &= ~(HOT | STACKED);
+    list_append(sim, HIRS, b);
+    lirs_prune(sim);
+}
+
+void lirs_hit(struct simStruct *sim, int cur, int j) {
+    if (sim->frameFlags[j] & HOT) {
+        stack_remove(sim, j);
+        stack_insert(sim, sim->stackHead, j);
+        lirs_prune(sim);
+    }
+    else if (sim->frameFlags[j] & STACKED) {
+        list_remove(sim, j);
+        stack_remove(sim, j);
+        stack_insert(sim, sim->stackHead, j);
+        lirs_promote(sim, j);
+    }
+    else {
+        sim->frameFlags[j] |= STACKED;
+        stack_insert(sim, sim->stackHead, j);
+        list_remove(sim, j);
+        list_append(sim, HIRS, j);
+    }
+}
+
+void lirs_fill(struct simStruct *sim, int cur, int j) {
+    int lhirs = sim->numframes/100 > 1 ? sim->numframes/100 : 1;
+    sim->frameFlags[j] = (sim->frameFlags[j] & ~HOT) | STACKED;
+    stack_insert(sim, sim->stackHead, j);
+    if (sim->hotPages < sim->numframes-lhirs) {
+        sim->frameFlags[j] |= HOT;
+        sim->hotPages++;
+    }
+    else {
+        list_append(sim, HIRS, j);
+    }
+}
+
+void my_lirs(struct simStruct *sim, int cur, unsigned long long index, unsigned char mode) {
+    int j = list_first(sim, HIRS);
+    int g;
+    list_remove(sim, j);
+    if (sim->frameFlags[j] & STACKED) {
+        g = ghost_new(sim, j);
+        stack_insert(sim, j, g);
+        stack_remove(sim, j);
+        list_append(sim, GHOSTS, g);
+        if (sim->numGhostFree == 0) {
+            g = list_first(sim, GHOSTS);
+            stack_remove(sim, g);
+            ghost_drop(sim, g);
+        }
+    }
+
+    g = ghost_find(sim, index);
+    if (g >= 0) {
+        stack_remove(sim, g);
+        ghost_drop(sim, g);
+    }
+    evict_frame(sim, j, index, mode);
+    sim->frameFlags[j] = (sim->frameFlags[j] & ~HOT) | STACKED;
+    stack_insert(sim, sim->stackHead, j);
+    if (g >= 0) {
+        lirs_promote(sim, j);
+    }
+    else {
+        list_append(sim, HIRS, j);
+    }
+}
+
+// Local replacement gives each process seen so far an equal share of the
+// frames. A process under its share takes a frame from one over its share;
+// otherwise it replaces one of its own pages.
+int local_under(struct simStruct *sim, int p) {
+    return sim->procResident[p] == 0 || sim->procResident[p] < sim->numframes/sim->procCount;
+}
+
+int local_victim(struct simStruct *sim, int j, int p, int under) {
+    int q = sim->framePage[j] >> PROCSHIFT;
+    if (under) {
+        return sim->procResident[q] > sim->numframes/sim->procCount;
+    }
+    return q == p;
 }